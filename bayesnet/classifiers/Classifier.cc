@@ -20,9 +20,13 @@ namespace bayesnet {
         checkFitParameters();
         auto n_classes = states.at(className).size();
         metrics = Metrics(dataset, features, className, n_classes);
+        if (statisticsCache && statisticsCache->matches(dataset)) {
+            metrics.setStatisticsCache(statisticsCache);
+        }
         model.initialize();
         buildModel(weights);
         trainModel(weights, smoothing);
+        finishFit();
         fitted = true;
         return *this;
     }
@@ -75,6 +79,15 @@ namespace bayesnet {
         this->dataset = dataset;
         return build(features, className, states, weights, smoothing);
     }
+    Classifier& Classifier::partial_fit(torch::Tensor& X, torch::Tensor& y, const torch::Tensor& weights)
+    {
+        if (!fitted) {
+            throw std::logic_error(CLASSIFIER_NOT_FITTED);
+        }
+        model.partial_fit(X, y, weights);
+        m += X.size(1); // the model keeps the counts, dataset only holds the samples given to fit
+        return *this;
+    }
     void Classifier::checkFitParameters()
     {
         if (torch::is_floating_point(dataset)) {
@@ -19,6 +19,9 @@ namespace bayesnet {
         Classifier& fit(torch::Tensor& X, torch::Tensor& y, const std::vector<std::string>& features, const std::string& className, std::map<std::string, std::vector<int>>& states, const Smoothing_t smoothing) override;
         Classifier& fit(torch::Tensor& dataset, const std::vector<std::string>& features, const std::string& className, std::map<std::string, std::vector<int>>& states, const Smoothing_t smoothing) override;
         Classifier& fit(torch::Tensor& dataset, const std::vector<std::string>& features, const std::string& className, std::map<std::string, std::vector<int>>& states, const torch::Tensor& weights, const Smoothing_t smoothing) override;
+        // Adds new samples (X nxm, y m) to a fitted classifier keeping its structure.
+        // Weights are in the scale used by fit, which gives 1/m to every sample.
+        virtual Classifier& partial_fit(torch::Tensor& X, torch::Tensor& y, const torch::Tensor& weights);
         void addNodes();
         int getNumberOfNodes() const override;
         int getNumberOfEdges() const override;
@@ -38,11 +41,16 @@ namespace bayesnet {
         std::string dump_cpt() const override;
         void setHyperparameters(const nlohmann::json& hyperparameters) override; //For classifiers that don't have hyperparameters
         Network& getModel() { return model; }
+        // Plan of the fitted network for the fused inference of the ensembles, null if predict does more than evaluating the network
+        virtual std::shared_ptr<const InferencePlan> getInferencePlan() const { return nullptr; }
+        // Statistics shared with other classifiers fitted on the same dataset, used only when fit gets the samples of the cache
+        void setStatisticsCache(std::shared_ptr<StatisticsCache> cache) { statisticsCache = cache; }
     protected:
         bool fitted;
         unsigned int m, n; // m: number of samples, n: number of features
         Network model;
         Metrics metrics;
+        std::shared_ptr<StatisticsCache> statisticsCache;
         std::vector<std::string> features;
         std::string className;
         std::map<std::string, std::vector<int>> states;
@@ -50,6 +58,7 @@ namespace bayesnet {
         void checkFitParameters();
         virtual void buildModel(const torch::Tensor& weights) = 0;
         void trainModel(const torch::Tensor& weights, const Smoothing_t smoothing) override;
+        virtual void finishFit() {} // called when fit has trained the model, before any prediction
         void buildDataset(torch::Tensor& y);
         const std::string CLASSIFIER_NOT_FITTED = "Classifier has not been fitted";
     private:
@@ -3,6 +3,7 @@
 // SPDX-FileType: SOURCE
 // SPDX-License-Identifier: MIT
 // ***************************************************************
+#include <algorithm>
 #include "bayesnet/utils/bayesnetUtils.h"
 #include "KDB.h"
 
@@ -49,12 +50,7 @@ namespace bayesnet {
         // 1. For each feature Xi, compute mutual information, I(X;C),
         // where C is the class.
         addNodes();
-        const torch::Tensor& y = dataset.index({ -1, "..." });
-        std::vector<double> mi;
-        for (auto i = 0; i < features.size(); i++) {
-            torch::Tensor firstFeature = dataset.index({ i, "..." });
-            mi.push_back(metrics.mutualInformation(firstFeature, y, weights));
-        }
+        std::vector<double> mi = metrics.classMutualInformation(weights);
         // 2. Compute class conditional mutual information I(Xi;XjIC), f or each
         auto conditionalEdgeWeights = metrics.conditionalEdge(weights);
         // 3. Let the used variable list, S, be empty.
@@ -76,28 +72,28 @@ namespace bayesnet {
             S.push_back(idx);
         }
     }
+    // Adds the edges from the (at most k) features of S with the highest I(Xidx;Xj|C) > theta to Xidx, in decreasing
+    // order of the value and ties by index. Xidx has no children yet, so these edges can not form a cycle
     void KDB::add_m_edges(int idx, std::vector<int>& S, torch::Tensor& weights)
     {
         auto n_edges = std::min(k, static_cast<int>(S.size()));
-        auto cond_w = clone(weights);
-        bool exit_cond = k == 0;
-        int num = 0;
-        while (!exit_cond) {
-            auto max_minfo = argmax(cond_w.index({ idx, "..." })).item<int>();
-            auto belongs = find(S.begin(), S.end(), max_minfo) != S.end();
-            if (belongs && cond_w.index({ idx, max_minfo }).item<float>() > theta) {
-                try {
-                    model.addEdge(features[max_minfo], features[idx]);
-                    num++;
-                }
-                catch (const std::invalid_argument& e) {
-                    // Loops are not allowed
-                }
+        if (n_edges <= 0) {
+            return;
+        }
+        const auto row = weights.select(0, idx).to(torch::kFloat32).contiguous();
+        const float* values = row.data_ptr<float>();
+        std::vector<int> candidates;
+        for (int feature : S) {
+            if (values[feature] > theta) {
+                candidates.push_back(feature);
             }
-            cond_w.index_put_({ idx, max_minfo }, -1);
-            auto candidates_mask = cond_w.index({ idx, "..." }).gt(theta);
-            auto candidates = candidates_mask.nonzero();
-            exit_cond = num == n_edges || candidates.size(0) == 0;
+        }
+        n_edges = std::min(n_edges, static_cast<int>(candidates.size()));
+        std::partial_sort(candidates.begin(), candidates.begin() + n_edges, candidates.end(), [values](int left, int right) {
+            return values[left] > values[right] || (values[left] == values[right] && left < right);
+            });
+        for (int i = 0; i < n_edges; ++i) {
+            model.addEdge(features[candidates[i]], features[idx]);
         }
     }
     std::vector<std::string> KDB::graph(const std::string& title) const
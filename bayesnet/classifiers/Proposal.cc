@@ -172,7 +172,7 @@ namespace bayesnet {
                 auto Xd = discretizers[pFeatures[i]]->transform(Xt);
                 Xtd.index_put_({ i }, torch::tensor(Xd, torch::kInt32));
             } else {
-                Xtd.index_put_({ i }, Xf[i].to(torch::kInt32));
+                Xtd.index_put_({ i }, X[i].to(torch::kInt32));
             }
         }
         return Xtd;
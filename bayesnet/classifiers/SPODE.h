@@ -15,6 +15,7 @@ namespace bayesnet {
         virtual ~SPODE() = default;
         void setHyperparameters(const nlohmann::json& hyperparameters_) override;
         std::vector<std::string> graph(const std::string& name = "SPODE") const override;
+        std::shared_ptr<const InferencePlan> getInferencePlan() const override { return fitted ? model.getInferencePlan() : nullptr; }
     protected:
         void buildModel(const torch::Tensor& weights) override;
     private:
@@ -38,6 +38,16 @@ namespace bayesnet {
         fitted = true;
         return *this;
     }
+    SPODELd& SPODELd::partial_fit(torch::Tensor& X_, torch::Tensor& y_, const torch::Tensor& weights)
+    {
+        if (!fitted) {
+            throw std::logic_error(CLASSIFIER_NOT_FITTED);
+        }
+        checkInput(X_, y_);
+        auto Xt = prepareX(X_);
+        SPODE::partial_fit(Xt, y_, weights);
+        return *this;
+    }
     torch::Tensor SPODELd::predict(torch::Tensor& X)
     {
         auto Xt = prepareX(X);
@@ -16,6 +16,8 @@ namespace bayesnet {
         virtual ~SPODELd() = default;
         SPODELd& fit(torch::Tensor& X, torch::Tensor& y, const std::vector<std::string>& features, const std::string& className, map<std::string, std::vector<int>>& states, const Smoothing_t smoothing) override;
         SPODELd& fit(torch::Tensor& dataset, const std::vector<std::string>& features, const std::string& className, map<std::string, std::vector<int>>& states, const Smoothing_t smoothing) override;
+        // Discretizes X with the cut points of fit before adding its counts to the model
+        SPODELd& partial_fit(torch::Tensor& X, torch::Tensor& y, const torch::Tensor& weights) override;
         SPODELd& commonFit(const std::vector<std::string>& features, const std::string& className, map<std::string, std::vector<int>>& states, const Smoothing_t smoothing);
         std::vector<std::string> graph(const std::string& name = "SPODELd") const override;
         void setHyperparameters(const nlohmann::json& hyperparameters_) override
@@ -26,6 +28,8 @@ namespace bayesnet {
         }
         torch::Tensor predict(torch::Tensor& X) override;
         torch::Tensor predict_proba(torch::Tensor& X) override;
+        // The samples are discretized before the network is evaluated
+        std::shared_ptr<const InferencePlan> getInferencePlan() const override { return nullptr; }
         static inline std::string version() { return "0.0.1"; };
     };
 }
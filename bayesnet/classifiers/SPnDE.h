@@ -15,6 +15,7 @@ namespace bayesnet {
         explicit SPnDE(std::vector<int> parents);
         virtual ~SPnDE() = default;
         std::vector<std::string> graph(const std::string& name = "SPnDE") const override;
+        std::shared_ptr<const InferencePlan> getInferencePlan() const override { return fitted ? model.getInferencePlan() : nullptr; }
     protected:
         void buildModel(const torch::Tensor& weights) override;
     private:
@@ -28,11 +28,9 @@ namespace bayesnet {
         // 1. Compute mutual information between each feature and the class and set the root node
         // as the highest mutual information with the class
         auto mi = std::vector <std::pair<int, float >>();
-        torch::Tensor class_dataset = dataset.index({ -1, "..." });
+        auto classInformation = metrics.classMutualInformation(weights);
         for (int i = 0; i < static_cast<int>(features.size()); ++i) {
-            torch::Tensor feature_dataset = dataset.index({ i, "..." });
-            auto mi_value = metrics.mutualInformation(class_dataset, feature_dataset, weights);
-            mi.push_back({ i, mi_value });
+            mi.push_back({ i, classInformation[i] });
         }
         sort(mi.begin(), mi.end(), [](const auto& left, const auto& right) {return left.second < right.second;});
         auto root = parent == -1 ? mi[mi.size() - 1].first : parent;
@@ -38,6 +38,16 @@ namespace bayesnet {
         fitted = true;
         return *this;
     }
+    TANLd& TANLd::partial_fit(torch::Tensor& X_, torch::Tensor& y_, const torch::Tensor& weights)
+    {
+        if (!fitted) {
+            throw std::logic_error(CLASSIFIER_NOT_FITTED);
+        }
+        checkInput(X_, y_);
+        auto Xt = prepareX(X_);
+        TAN::partial_fit(Xt, y_, weights);
+        return *this;
+    }
     torch::Tensor TANLd::predict(torch::Tensor& X)
     {
         auto Xt = prepareX(X);
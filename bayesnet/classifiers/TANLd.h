@@ -17,6 +17,8 @@ namespace bayesnet {
         virtual ~TANLd() = default;
         TANLd& fit(torch::Tensor& X, torch::Tensor& y, const std::vector<std::string>& features, const std::string& className, map<std::string, std::vector<int>>& states, const Smoothing_t smoothing) override;
         TANLd& fit(torch::Tensor& dataset, const std::vector<std::string>& features, const std::string& className, map<std::string, std::vector<int>>& states, const Smoothing_t smoothing) override;
+        // Discretizes X with the cut points of fit before adding its counts to the model
+        TANLd& partial_fit(torch::Tensor& X, torch::Tensor& y, const torch::Tensor& weights) override;
         TANLd& commonFit(const std::vector<std::string>& features, const std::string& className, map<std::string, std::vector<int>>& states, const Smoothing_t smoothing);
         std::vector<std::string> graph(const std::string& name = "TANLd") const override;
         void setHyperparameters(const nlohmann::json& hyperparameters_) override
@@ -5,13 +5,13 @@
 // ***************************************************************
 
 #include "XSP2DE.h"
-#include <pthread.h>   // for pthread_setname_np on linux
 #include <cassert>
 #include <cmath>
 #include <limits>
 #include <stdexcept>
 #include <iostream>
 #include "bayesnet/utils/TensorUtils.h"
+#include "bayesnet/utils/ThreadPool.h"
 
 namespace bayesnet {
 
@@ -25,7 +25,6 @@ XSp2de::XSp2de(int spIndex1, int spIndex2)
   , statesClass_{0}
   , alpha_{1.0}
   , initializer_{1.0}
-  , semaphore_{ CountingSemaphore::getInstance() }
   , Classifier(Network())
 {
   validHyperparameters = { "parent1", "parent2" };
@@ -137,7 +136,19 @@ void XSp2de::trainModel(const torch::Tensor &weights,
   }
 
   // Choose alpha based on smoothing:
-  switch (smoothing) {
+  smoothing_ = smoothing;
+  setAlpha();
+
+  // Large initializer factor for numerical stability
+  initializer_ = std::numeric_limits<double>::max() / (nFeatures_ * nFeatures_);
+
+  // Convert raw counts to probabilities
+  computeProbabilities();
+}
+
+void XSp2de::setAlpha()
+{
+  switch (smoothing_) {
     case bayesnet::Smoothing_t::ORIGINAL:
       alpha_ = 1.0 / m;
       break;
@@ -147,12 +158,50 @@ void XSp2de::trainModel(const torch::Tensor &weights,
     default:
       alpha_ = 0.0; // no smoothing
   }
+}
 
-  // Large initializer factor for numerical stability
-  initializer_ = std::numeric_limits<double>::max() / (nFeatures_ * nFeatures_);
-
-  // Convert raw counts to probabilities
+// --------------------------------------
+// partial_fit
+// --------------------------------------
+// Adds the counts of new samples and recomputes the probabilities,
+// the states found in fit are kept.
+Classifier &XSp2de::partial_fit(torch::Tensor &X, torch::Tensor &y, const torch::Tensor &weights)
+{
+  if (!fitted) {
+    throw std::logic_error(CLASSIFIER_NOT_FITTED);
+  }
+  if (X.size(0) != nFeatures_ || X.size(1) != y.size(0) || X.size(1) != weights.size(0)) {
+    throw std::invalid_argument("XSp2de::partial_fit: X must be " + std::to_string(nFeatures_) + "xm with m labels and weights");
+  }
+  auto X_ = X.to(torch::kInt32).contiguous();
+  auto y_ = y.to(torch::kInt32).contiguous();
+  auto weights_ = weights.to(torch::kFloat64).contiguous();
+  auto X_acc = X_.accessor<int, 2>();
+  auto y_acc = y_.accessor<int, 1>();
+  auto w_acc = weights_.accessor<double, 1>();
+  // Check the whole batch before counting so a wrong value leaves the model untouched
+  for (int i = 0; i < X_.size(1); i++) {
+    for (int f = 0; f < nFeatures_; f++) {
+      if (X_acc[f][i] < 0 || X_acc[f][i] >= states_[f]) {
+        throw std::out_of_range("XSp2de::partial_fit: value " + std::to_string(X_acc[f][i]) + " out of range for feature " + std::to_string(f));
+      }
+    }
+    if (y_acc[i] < 0 || y_acc[i] >= statesClass_) {
+      throw std::out_of_range("XSp2de::partial_fit: class " + std::to_string(y_acc[i]) + " out of range");
+    }
+  }
+  std::vector<int> instance(nFeatures_ + 1);
+  for (int i = 0; i < X_.size(1); i++) {
+    for (int f = 0; f < nFeatures_; f++) {
+      instance[f] = X_acc[f][i];
+    }
+    instance[nFeatures_] = y_acc[i];
+    addSample(instance, w_acc[i]);
+  }
+  m += X.size(1);
+  setAlpha();
   computeProbabilities();
+  return *this;
 }
 
 // --------------------------------------
@@ -363,41 +412,17 @@ std::vector<std::vector<double>> XSp2de::predict_proba(std::vector<std::vector<i
       test_size, std::vector<double>(statesClass_, 0.0));
 
   // same concurrency approach
-  int chunk_size = std::min(150, int(test_size / semaphore_.getMaxCount()) + 1);
-  std::vector<std::thread> threads;
-
-  auto worker = [&](const std::vector<std::vector<int>> &samples, 
-                    int begin, 
-                    int chunk, 
-                    int sample_size, 
-                    std::vector<std::vector<double>> &predictions) {
-    std::string threadName =
-      "XSp2de-" + std::to_string(begin) + "-" + std::to_string(chunk);
-#if defined(__linux__)
-    pthread_setname_np(pthread_self(), threadName.c_str());
-#else
-    pthread_setname_np(threadName.c_str());
-#endif
-
+  auto& pool = ThreadPool::getInstance();
+  int chunk_size = std::min(150, int(test_size / pool.getNumThreads()) + 1);
+  pool.parallel_for(0, test_size, chunk_size, [&](int64_t begin, int64_t end) {
     std::vector<int> instance(sample_size);
-    for (int sample = begin; sample < begin + chunk; ++sample) {
+    for (int64_t sample = begin; sample < end; ++sample) {
       for (int feature = 0; feature < sample_size; ++feature) {
-        instance[feature] = samples[feature][sample];
+        instance[feature] = test_data[feature][sample];
       }
-      predictions[sample] = predict_proba(instance);
+      probabilities[sample] = predict_proba(instance);
     }
-    semaphore_.release();
-  };
-
-  for (int begin = 0; begin < test_size; begin += chunk_size) {
-    int chunk = std::min(chunk_size, test_size - begin);
-    semaphore_.acquire();
-    threads.emplace_back(worker, test_data, begin, chunk, sample_size, 
-                         std::ref(probabilities));
-  }
-  for (auto &th : threads) {
-    th.join();
-  }
+  });
   return probabilities;
 }
 
@@ -8,7 +8,6 @@
 #define XSP2DE_H
 
 #include "Classifier.h"
-#include "bayesnet/utils/CountingSemaphore.h"
 #include <torch/torch.h>
 #include <vector>
 
@@ -19,6 +18,7 @@ class XSp2de : public Classifier {
     XSp2de(int spIndex1, int spIndex2);
     void setHyperparameters(const nlohmann::json &hyperparameters_) override;
     void fitx(torch::Tensor &X, torch::Tensor &y, torch::Tensor &weights_, const Smoothing_t smoothing);
+    Classifier& partial_fit(torch::Tensor &X, torch::Tensor &y, const torch::Tensor &weights) override;
     std::vector<double> predict_proba(const std::vector<int> &instance) const;
     std::vector<std::vector<double>> predict_proba(std::vector<std::vector<int>> &test_data) override;
     int predict(const std::vector<int> &instance) const;
@@ -47,12 +47,14 @@ class XSp2de : public Classifier {
     void addSample(const std::vector<int> &instance, double weight);
     void normalize(std::vector<double> &v) const;
     void computeProbabilities();
+    void setAlpha();
 
     int superParent1_;
     int superParent2_;
     int nFeatures_;
     int statesClass_;
     double alpha_;
+    Smoothing_t smoothing_ = Smoothing_t::NONE;
     double initializer_;
 
     std::vector<int> states_;
@@ -68,7 +70,6 @@ class XSp2de : public Classifier {
     // dimension block of size: states_[f]* statesClass_* states_[sp1]* states_[sp2].
     std::vector<double> childCounts_;
     std::vector<double> childProbs_;
-    CountingSemaphore &semaphore_;
 };
 
 } // namespace bayesnet
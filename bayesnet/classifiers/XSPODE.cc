@@ -11,6 +11,7 @@
 #include <stdexcept>
 #include "XSPODE.h"
 #include "bayesnet/utils/TensorUtils.h"
+#include "bayesnet/utils/ThreadPool.h"
 
 namespace bayesnet {
 
@@ -19,10 +20,10 @@ namespace bayesnet {
   // --------------------------------------
   XSpode::XSpode(int spIndex)
     : superParent_{ spIndex }, nFeatures_{ 0 }, statesClass_{ 0 }, alpha_{ 1.0 },
-    initializer_{ 1.0 }, semaphore_{ CountingSemaphore::getInstance() },
+    initializer_{ 1.0 },
     Classifier(Network())
   {
-    validHyperparameters = { "parent" };
+    validHyperparameters = { "parent", "log_space" };
   }
 
   void XSpode::setHyperparameters(const nlohmann::json& hyperparameters_)
@@ -32,6 +33,10 @@ namespace bayesnet {
       superParent_ = hyperparameters["parent"];
       hyperparameters.erase("parent");
     }
+    if (hyperparameters.contains("log_space")) {
+      logSpace_ = hyperparameters["log_space"];
+      hyperparameters.erase("log_space");
+    }
     Classifier::setHyperparameters(hyperparameters);
   }
 
@@ -114,7 +119,17 @@ namespace bayesnet {
       instance[nFeatures_] = dataset[-1][i].item<int>();
       addSample(instance, weights[i].item<double>());
     }
-    switch (smoothing) {
+    smoothing_ = smoothing;
+    setAlpha();
+    initializer_ = std::numeric_limits<double>::max() /
+      (nFeatures_ * nFeatures_); // for numerical stability
+    // Convert raw counts to probabilities
+    computeProbabilities();
+  }
+
+  void XSpode::setAlpha()
+  {
+    switch (smoothing_) {
       case bayesnet::Smoothing_t::ORIGINAL:
         alpha_ = 1.0 / m;
         break;
@@ -124,10 +139,51 @@ namespace bayesnet {
       default:
         alpha_ = 0.0; // No smoothing
     }
-    initializer_ = std::numeric_limits<double>::max() /
-      (nFeatures_ * nFeatures_); // for numerical stability
-    // Convert raw counts to probabilities
+  }
+  // --------------------------------------
+  // partial_fit
+  // --------------------------------------
+  //
+  // Adds the counts of new samples and recomputes the probabilities,
+  // the states found in fit are kept.
+  //
+  Classifier& XSpode::partial_fit(torch::Tensor& X, torch::Tensor& y, const torch::Tensor& weights)
+  {
+    if (!fitted) {
+      throw std::logic_error(CLASSIFIER_NOT_FITTED);
+    }
+    if (X.size(0) != nFeatures_ || X.size(1) != y.size(0) || X.size(1) != weights.size(0)) {
+      throw std::invalid_argument("XSpode::partial_fit: X must be " + std::to_string(nFeatures_) + "xm with m labels and weights");
+    }
+    auto X_ = X.to(torch::kInt32).contiguous();
+    auto y_ = y.to(torch::kInt32).contiguous();
+    auto weights_ = weights.to(torch::kFloat64).contiguous();
+    auto X_acc = X_.accessor<int, 2>();
+    auto y_acc = y_.accessor<int, 1>();
+    auto w_acc = weights_.accessor<double, 1>();
+    std::vector<int> instance(nFeatures_ + 1);
+    // Check the whole batch before counting so a wrong value leaves the model untouched
+    for (int i = 0; i < X_.size(1); i++) {
+      for (int f = 0; f < nFeatures_; f++) {
+        if (X_acc[f][i] < 0 || X_acc[f][i] >= states_[f]) {
+          throw std::out_of_range("XSpode::partial_fit: value " + std::to_string(X_acc[f][i]) + " out of range for feature " + std::to_string(f));
+        }
+      }
+      if (y_acc[i] < 0 || y_acc[i] >= statesClass_) {
+        throw std::out_of_range("XSpode::partial_fit: class " + std::to_string(y_acc[i]) + " out of range");
+      }
+    }
+    for (int i = 0; i < X_.size(1); i++) {
+      for (int f = 0; f < nFeatures_; f++) {
+        instance[f] = X_acc[f][i];
+      }
+      instance[nFeatures_] = y_acc[i];
+      addSample(instance, w_acc[i]);
+    }
+    m += X.size(1);
+    setAlpha();
     computeProbabilities();
+    return *this;
   }
 
   // --------------------------------------
@@ -232,6 +288,13 @@ namespace bayesnet {
         }
       }
     }
+    if (logSpace_) {
+      // In log space the tables hold log probabilities, log(0) = -inf
+      auto toLog = [](double p) { return std::log(p); };
+      std::transform(classPriors_.begin(), classPriors_.end(), classPriors_.begin(), toLog);
+      std::transform(spFeatureProbs_.begin(), spFeatureProbs_.end(), spFeatureProbs_.begin(), toLog);
+      std::transform(childProbs_.begin(), childProbs_.end(), childProbs_.begin(), toLog);
+    }
   }
 
   // --------------------------------------
@@ -248,8 +311,24 @@ namespace bayesnet {
       throw std::logic_error(CLASSIFIER_NOT_FITTED);
     }
     std::vector<double> probs(statesClass_, 0.0);
-    // Multiply p(c) × p(x_sp | c)
     int spVal = instance[superParent_];
+    if (logSpace_) {
+      // Same product as below as a sum of logs, no scaling needed
+      for (int c = 0; c < statesClass_; c++) {
+        probs[c] = classPriors_[c] + spFeatureProbs_[spVal * statesClass_ + c];
+      }
+      for (int feature = 0; feature < nFeatures_; feature++) {
+        if (feature == superParent_)
+          continue; // skip sp
+        int base = childOffsets_[feature] + spVal * (states_[feature] * statesClass_) + instance[feature] * statesClass_;
+        for (int c = 0; c < statesClass_; c++) {
+          probs[c] += childProbs_[base + c];
+        }
+      }
+      normalizeLog(probs);
+      return probs;
+    }
+    // Multiply p(c) × p(x_sp | c)
     for (int c = 0; c < statesClass_; c++) {
       double pc = classPriors_[c];
       double pSpC = spFeatureProbs_[spVal * statesClass_ + c];
@@ -282,36 +361,17 @@ namespace bayesnet {
     auto probabilities = std::vector<std::vector<double>>(
       test_size, std::vector<double>(statesClass_));
 
-    int chunk_size = std::min(150, int(test_size / semaphore_.getMaxCount()) + 1);
-    std::vector<std::thread> threads;
-    auto worker = [&](const std::vector<std::vector<int>>& samples, int begin,
-      int chunk, int sample_size,
-      std::vector<std::vector<double>>& predictions) {
-        std::string threadName =
-          "(V)PWorker-" + std::to_string(begin) + "-" + std::to_string(chunk);
-#if defined(__linux__)
-        pthread_setname_np(pthread_self(), threadName.c_str());
-#else
-        pthread_setname_np(threadName.c_str());
-#endif
-
-        std::vector<int> instance(sample_size);
-        for (int sample = begin; sample < begin + chunk; ++sample) {
-          for (int feature = 0; feature < sample_size; ++feature) {
-            instance[feature] = samples[feature][sample];
-          }
-          predictions[sample] = predict_proba(instance);
+    auto& pool = ThreadPool::getInstance();
+    int chunk_size = std::min(150, int(test_size / pool.getNumThreads()) + 1);
+    pool.parallel_for(0, test_size, chunk_size, [&](int64_t begin, int64_t end) {
+      std::vector<int> instance(sample_size);
+      for (int64_t sample = begin; sample < end; ++sample) {
+        for (int feature = 0; feature < sample_size; ++feature) {
+          instance[feature] = test_data[feature][sample];
         }
-        semaphore_.release();
-      };
-    for (int begin = 0; begin < test_size; begin += chunk_size) {
-      int chunk = std::min(chunk_size, test_size - begin);
-      semaphore_.acquire();
-      threads.emplace_back(worker, test_data, begin, chunk, sample_size, std::ref(probabilities));
-    }
-    for (auto& thread : threads) {
-      thread.join();
-    }
+        probabilities[sample] = predict_proba(instance);
+      }
+      });
     return probabilities;
   }
 
@@ -331,6 +391,20 @@ namespace bayesnet {
       val /= sum;
     }
   }
+  // Turn log probabilities into normalized probabilities with log-sum-exp
+  void XSpode::normalizeLog(std::vector<double>& v) const
+  {
+    double maxValue = *std::max_element(v.begin(), v.end());
+    if (maxValue == -std::numeric_limits<double>::infinity()) {
+      // every class has probability 0, same result as normalize
+      std::fill(v.begin(), v.end(), 0.0);
+      return;
+    }
+    for (auto& val : v) {
+      val = std::exp(val - maxValue);
+    }
+    normalize(v);
+  }
 
   // --------------------------------------
   // representation of the model
@@ -10,7 +10,6 @@
 #include <vector>
 #include <torch/torch.h>
 #include "Classifier.h"
-#include "bayesnet/utils/CountingSemaphore.h"
 
 namespace bayesnet {
 
@@ -21,6 +20,7 @@ namespace bayesnet {
         std::vector<std::vector<double>> predict_proba(std::vector<std::vector<int>>& X) override;
         int predict(const std::vector<int>& instance) const;
         void normalize(std::vector<double>& v) const;
+        void normalizeLog(std::vector<double>& v) const;
         std::string to_string() const;
         int getNFeatures() const;
         int getNumberOfNodes() const override;
@@ -30,6 +30,7 @@ namespace bayesnet {
         std::vector<int>& getStates();
         std::vector<std::string> graph(const std::string& title) const override { return std::vector<std::string>({ title }); }
         void fitx(torch::Tensor& X, torch::Tensor& y, torch::Tensor& weights_, const Smoothing_t smoothing);
+        Classifier& partial_fit(torch::Tensor& X, torch::Tensor& y, const torch::Tensor& weights) override;
         void setHyperparameters(const nlohmann::json& hyperparameters_) override;
 
         //
@@ -46,6 +47,7 @@ namespace bayesnet {
     private:
         void addSample(const std::vector<int>& instance, double weight);
         void computeProbabilities();
+        void setAlpha();
         int superParent_;
         int nFeatures_;
         int statesClass_;
@@ -68,8 +70,9 @@ namespace bayesnet {
         std::vector<int>    childOffsets_;
 
         double alpha_ = 1.0;
+        Smoothing_t smoothing_ = Smoothing_t::NONE;
         double initializer_; // for numerical stability
-        CountingSemaphore& semaphore_;
+        bool logSpace_ = false; // probabilities stored as logs, accumulated with sums
     };
 }
 
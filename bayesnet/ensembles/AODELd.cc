@@ -4,6 +4,7 @@
 // SPDX-License-Identifier: MIT
 // ***************************************************************
 
+#include "bayesnet/utils/ThreadPool.h"
 #include "AODELd.h"
 
 namespace bayesnet {
@@ -31,6 +32,7 @@ namespace bayesnet {
         const torch::Tensor weights = torch::full({ Xf.size(1) }, 1.0 / m, torch::kDouble);
         buildModel(weights);
         trainModel(weights, smoothing);
+        finishFit();
         fitted = true;
         return *this;
 
@@ -47,11 +49,14 @@ namespace bayesnet {
     }
     void AODELd::trainModel(const torch::Tensor& weights, const Smoothing_t smoothing)
     {
-        for (const auto& model : models) {
-            // model->fit(dataset, features, className, states, smoothing);
-            model->fit(Xf, y, features, className, states, smoothing);
-            //static_cast<SPODELd*>(model.get())->fit_disc(Xf, pDataset, features, className, states, smoothing, wasNumeric);
-        }
+        // Every SPODELd discretizes its own copy of the data, so they are fitted concurrently as in Ensemble::trainModel
+        ThreadPool::getInstance().parallel_for(0, models.size(), 1, [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; ++i) {
+                // model->fit(dataset, features, className, states, smoothing);
+                models[i]->fit(Xf, y, features, className, states, smoothing);
+                //static_cast<SPODELd*>(model.get())->fit_disc(Xf, pDataset, features, className, states, smoothing, wasNumeric);
+            }
+            });
     }
     std::vector<std::string> AODELd::graph(const std::string& name) const
     {
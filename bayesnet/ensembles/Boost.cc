@@ -84,18 +84,40 @@ namespace bayesnet {
         }
         Classifier::setHyperparameters(hyperparameters);
     }
-    void Boost::add_model(std::unique_ptr<Classifier> model, double significance)
+    void Boost::add_model(std::unique_ptr<Classifier> model, double significance, const torch::Tensor& trainContribution)
     {
+        if (trainSums.isActive()) {
+            trainSums.add(trainContribution.defined() ? trainContribution : trainSums.contribution(*model), significance);
+        }
+        if (testSums.isActive()) {
+            testSums.add(testSums.contribution(*model), significance);
+        }
         models.push_back(std::move(model));
         n_models++;
         significanceModels.push_back(significance);
     }
     void Boost::remove_last_model()
     {
+        if (trainSums.isActive()) {
+            trainSums.removeLast();
+        }
+        if (testSums.isActive()) {
+            testSums.removeLast();
+        }
         models.pop_back();
         significanceModels.pop_back();
         n_models--;
     }
+    void Boost::update_significances(int first, double significance)
+    {
+        std::fill(significanceModels.begin() + first, significanceModels.end(), significance);
+        if (trainSums.isActive()) {
+            trainSums.setSignificances(significanceModels);
+        }
+        if (testSums.isActive()) {
+            testSums.setSignificances(significanceModels);
+        }
+    }
     void Boost::buildModel(const torch::Tensor& weights)
     {
         // Models shall be built in trainModel
@@ -145,6 +167,7 @@ namespace bayesnet {
             featureSelector =
                 new FCBF(dataset, features, className, maxFeatures, states.at(className).size(), weights_, threshold);
         }
+        featureSelector->setStatisticsCache(metrics.getStatisticsCache());
         featureSelector->fit();
         auto featuresUsed = featureSelector->getFeatures();
         delete featureSelector;
@@ -177,6 +200,7 @@ namespace bayesnet {
             // Step 3.3: Normalise the weights
             double totalWeights = torch::sum(weights).item<double>();
             weights = weights / totalWeights;
+            reweighted = reweighted.defined() ? reweighted.logical_or(mask_wrong) : mask_wrong;
         }
         return { weights, alpha_t, terminate };
     }
@@ -222,6 +246,15 @@ namespace bayesnet {
             9. Update last k significances
             10. n_models <- n_models_bak
         */
+        if (trainSums.isActive()) {
+            // The stored predictions of the last k models give the same result without moving them
+            auto ypred = trainSums.predictLast(k);
+            double alpha_t;
+            bool terminate;
+            std::tie(weights, alpha_t, terminate) = update_weights(y_train, ypred, weights);
+            update_significances(n_models - k, alpha_t);
+            return { weights, alpha_t, terminate };
+        }
         //
         // Make predict with only the last k models
         //
@@ -12,6 +12,7 @@
 #include <nlohmann/json.hpp>
 #include <torch/torch.h>
 #include "Ensemble.h"
+#include "ProbabilityAccumulator.h"
 #include "bayesnet/feature_selection/FeatureSelect.h"
 namespace bayesnet {
     const struct {
@@ -34,12 +35,18 @@ namespace bayesnet {
         void buildModel(const torch::Tensor& weights) override;
         std::tuple<torch::Tensor&, double, bool> update_weights(torch::Tensor& ytrain, torch::Tensor& ypred, torch::Tensor& weights);
         std::tuple<torch::Tensor&, double, bool> update_weights_block(int k, torch::Tensor& ytrain, torch::Tensor& weights);
-        void add_model(std::unique_ptr<Classifier> model, double significance);
+        // trainContribution is the contribution of the model to trainSums if it has already been computed
+        void add_model(std::unique_ptr<Classifier> model, double significance, const torch::Tensor& trainContribution = torch::Tensor());
         void remove_last_model();
+        // Sets the significance of the models from first on
+        void update_significances(int first, double significance);
         //
         // Attributes
         //
         torch::Tensor X_train, y_train, X_test, y_test;
+        torch::Tensor reweighted; // samples misclassified by update_weights since it was last cleared, i.e. whose weight changed relative to the rest
+        // Running predictions of the ensemble on the train and test sets, only kept while training if they are active
+        ProbabilityAccumulator trainSums, testSums;
         // Hyperparameters
         bool bisection = true; // if true, use bisection stratety to add k models at once to the ensemble
         int maxTolerance = 3;
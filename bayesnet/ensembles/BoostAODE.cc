@@ -6,6 +6,7 @@
 
 #include "BoostAODE.h"
 #include "bayesnet/classifiers/SPODE.h"
+#include "bayesnet/utils/MutualInformationRanker.h"
 #include <limits.h>
 // #include <loguru.cpp>
 // #include <loguru.hpp>
@@ -25,9 +26,7 @@ namespace bayesnet {
         for (const int& feature : featuresSelected) {
             std::unique_ptr<Classifier> model = std::make_unique<SPODE>(feature);
             model->fit(dataset, features, className, states, weights_, smoothing);
-            models.push_back(std::move(model));
-            significanceModels.push_back(1.0); // They will be updated later in trainModel
-            n_models++;
+            add_model(std::move(model), 1.0); // They will be updated later in trainModel
         }
         notes.push_back("Used features in initialization: " + std::to_string(featuresSelected.size()) + " of " + std::to_string(features.size()) + " with " + select_features_algorithm);
         return featuresSelected;
@@ -49,18 +48,21 @@ namespace bayesnet {
         bool finished = false;
         std::vector<int> featuresUsed;
         n_models = 0;
+        // Keep the predictions of the ensemble on the sets where it is evaluated after adding every model
+        int numClasses = states.at(className).size();
+        trainSums = alpha_block || block_update ? ProbabilityAccumulator(X_train, numClasses, predict_voting) : ProbabilityAccumulator();
+        testSums = convergence ? ProbabilityAccumulator(X_test, numClasses, predict_voting) : ProbabilityAccumulator();
         if (selectFeatures) {
             featuresUsed = initializeModels(smoothing);
-            auto ypred = predict(X_train);
+            auto ypred = trainSums.isActive() ? trainSums.predict() : predict(X_train);
             if (!weightless) {
                 std::tie(weights_, alpha_t, finished) = update_weights(y_train, ypred, weights_);
             }
             // Update significance of the models
-            for (int i = 0; i < n_models; ++i) {
-                significanceModels[i] = alpha_t;
-            }
+            update_significances(0, alpha_t);
             // VLOG_SCOPE_F(1, "SelectFeatures. alpha_t: %f n_models: %d", alpha_t, n_models);
             if (finished) {
+                trainSums = testSums = ProbabilityAccumulator();
                 return;
             }
         }
@@ -76,9 +78,14 @@ namespace bayesnet {
         // run out of features
         bool ascending = order_algorithm == Orders.ASC;
         std::mt19937 g{ 173 };
+        // The ranker keeps the histograms of the features and only recounts the samples reweighted between rankings
+        MutualInformationRanker ranker(dataset, weights_);
+        reweighted = torch::zeros({ m }, torch::kBool);
         while (!finished) {
             // Step 1: Build ranking with mutual information
-            auto featureSelection = metrics.SelectKBestWeighted(weights_, ascending, n); // Get all the features sorted
+            ranker.update(weights_, reweighted);
+            reweighted = torch::zeros({ m }, torch::kBool);
+            auto featureSelection = ranker.SelectKBest(ascending, n); // Get all the features sorted
             if (order_algorithm == Orders.RAND) {
                 std::shuffle(featureSelection.begin(), featureSelection.end(), g);
             }
@@ -96,23 +103,15 @@ namespace bayesnet {
                 model = std::make_unique<SPODE>(feature);
                 model->fit(dataset, features, className, states, weights_, smoothing);
                 alpha_t = weightless ? 1.0 : 0.0;
+                torch::Tensor contribution;
                 if (!block_update) {
                     torch::Tensor ypred;
                     if (alpha_block) {
                         //
                         // Compute the prediction with the current ensemble + model
                         //
-                        // Add the model to the ensemble
-                        n_models++;
-                        models.push_back(std::move(model));
-                        significanceModels.push_back(1.0);
-                        // Compute the prediction
-                        ypred = predict(X_train);
-                        // Remove the model from the ensemble
-                        model = std::move(models.back());
-                        models.pop_back();
-                        significanceModels.pop_back();
-                        n_models--;
+                        contribution = trainSums.contribution(*model);
+                        ypred = trainSums.predict(contribution, 1.0);
                     } else {
                         ypred = model->predict(X_train);
                     }
@@ -124,16 +123,14 @@ namespace bayesnet {
                 // Step 3.4: Store classifier and its accuracy to weigh its future vote
                 numItemsPack++;
                 featuresUsed.push_back(feature);
-                models.push_back(std::move(model));
-                significanceModels.push_back(alpha_t);
-                n_models++;
+                add_model(std::move(model), alpha_t, contribution);
                 // VLOG_SCOPE_F(2, "finished: %d numItemsPack: %d n_models: %d featuresUsed: %zu", finished, numItemsPack, n_models, featuresUsed.size());
             }
             if (block_update && !weightless) {
                 std::tie(weights_, alpha_t, finished) = update_weights_block(k, y_train, weights_);
             }
             if (convergence && !finished) {
-                auto y_val_predict = predict(X_test);
+                auto y_val_predict = testSums.predict();
                 double accuracy = (y_val_predict == y_test).sum().item<double>() / (double)y_test.size(0);
                 if (priorAccuracy == 0) {
                     priorAccuracy = accuracy;
@@ -164,15 +161,14 @@ namespace bayesnet {
                 notes.push_back("Convergence threshold reached & " + std::to_string(numItemsPack) + " models eliminated");
                 // VLOG_SCOPE_F(4, "Convergence threshold reached & %d models eliminated of %d", numItemsPack, n_models);
                 for (int i = 0; i < numItemsPack; ++i) {
-                    significanceModels.pop_back();
-                    models.pop_back();
-                    n_models--;
+                    remove_last_model();
                 }
             } else {
                 notes.push_back("Convergence threshold reached & 0 models eliminated");
                 // VLG_SCOPE_F(4, "Convergence threshold reached & 0 models eliminated n_models=%d numItemsPack=%d", n_models, numItemsPack);
             }
         }
+        trainSums = testSums = ProbabilityAccumulator();
         if (featuresUsed.size() != features.size()) {
             notes.push_back("Used features in train: " + std::to_string(featuresUsed.size()) + " of " + std::to_string(features.size()));
             status = WARNING;
@@ -3,6 +3,7 @@
 // SPDX-FileType: SOURCE
 // SPDX-License-Identifier: MIT
 // ***************************************************************
+#include "bayesnet/utils/ThreadPool.h"
 #include "Ensemble.h"
 
 namespace bayesnet {
@@ -14,18 +15,32 @@ namespace bayesnet {
     void Ensemble::trainModel(const torch::Tensor& weights, const Smoothing_t smoothing)
     {
         n_models = models.size();
-        for (auto i = 0; i < n_models; ++i) {
-            // fit with std::vectors
-            models[i]->fit(dataset, features, className, states, smoothing);
+        // The members are independent, every one is fitted in a task of the library pool, the parallel loops
+        // inside their fit are nested in the same pool so the number of threads does not grow
+        ThreadPool::getInstance().parallel_for(0, n_models, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; ++i) {
+                models[i]->fit(dataset, features, className, states, smoothing);
+            }
+            });
+    }
+    Ensemble& Ensemble::partial_fit(torch::Tensor& X, torch::Tensor& y, const torch::Tensor& weights)
+    {
+        if (!fitted) {
+            throw std::logic_error(ENSEMBLE_NOT_FITTED);
+        }
+        for (auto& model : models) {
+            model->partial_fit(X, y, weights);
         }
+        m += X.size(1);
+        finishFit();
+        return *this;
     }
     std::vector<int> Ensemble::compute_arg_max(std::vector<std::vector<double>>& X)
     {
-        std::vector<int> y_pred;
-        for (auto i = 0; i < X.size(); ++i) {
-            auto max = std::max_element(X[i].begin(), X[i].end());
-            y_pred.push_back(std::distance(X[i].begin(), max));
-        }
+        std::vector<int> y_pred(X.size());
+        std::transform(X.begin(), X.end(), y_pred.begin(), [](const std::vector<double>& row) {
+            return static_cast<int>(std::distance(row.begin(), std::max_element(row.begin(), row.end())));
+            });
         return y_pred;
     }
     torch::Tensor Ensemble::compute_arg_max(torch::Tensor& X)
@@ -36,25 +51,48 @@ namespace bayesnet {
     torch::Tensor Ensemble::voting(torch::Tensor& votes)
     {
         // Convert m x n_models tensor to a m x n_class_states with voting probabilities
-        auto y_pred_ = votes.accessor<int, 2>();
-        std::vector<int> y_pred_final;
         int numClasses = states.at(className).size();
         // votes is m x n_models with the prediction of every model for each sample
-        auto result = torch::zeros({ votes.size(0), numClasses }, torch::kFloat32);
+        // every row gets the significance of each model added in the column of the class it predicts,
+        // the votes are added with doubles in the order of the models
+        auto significances = torch::tensor(std::vector<double>(significanceModels.begin(), significanceModels.begin() + n_models), torch::kFloat64);
+        auto n_votes = torch::zeros({ votes.size(0), numClasses }, torch::kFloat64);
+        n_votes.scatter_add_(1, votes.to(torch::kInt64), significances.expand({ votes.size(0), static_cast<int64_t>(n_models) }));
         auto sum = std::reduce(significanceModels.begin(), significanceModels.end());
-        for (int i = 0; i < votes.size(0); ++i) {
-            // n_votes store in each index (value of class) the significance added by each model
-            // i.e. n_votes[0] contains how much value has the value 0 of class. That value is generated by the models predictions
-            std::vector<double> n_votes(numClasses, 0.0);
-            for (int j = 0; j < n_models; ++j) {
-                n_votes[y_pred_[i][j]] += significanceModels.at(j);
-            }
-            result[i] = torch::tensor(n_votes);
-        }
+        auto result = n_votes.to(torch::kFloat32);
         // To only do one division and gain precision
         result /= sum;
         return result;
     }
+    std::vector<std::shared_ptr<const InferencePlan>> Ensemble::getModelPlans() const
+    {
+        std::vector<std::shared_ptr<const InferencePlan>> plans;
+        plans.reserve(n_models);
+        for (unsigned i = 0; i < n_models; ++i) {
+            auto plan = models[i]->getInferencePlan();
+            if (!plan) {
+                return {};
+            }
+            plans.push_back(std::move(plan));
+        }
+        return plans;
+    }
+    void Ensemble::finishFit()
+    {
+        ensemblePlan.reset();
+        auto plans = getModelPlans();
+        if (!plans.empty()) {
+            ensemblePlan = std::make_shared<const EnsemblePlan>(plans, std::vector<double>(significanceModels.begin(), significanceModels.begin() + n_models));
+        }
+    }
+    const EnsemblePlan* Ensemble::getEnsemblePlan() const
+    {
+        // The boosting ensembles predict while they add models, the plan is only used if it was built with the current ones
+        if (!ensemblePlan || !ensemblePlan->matches(getModelPlans(), std::vector<double>(significanceModels.begin(), significanceModels.begin() + n_models))) {
+            return nullptr;
+        }
+        return ensemblePlan.get();
+    }
     std::vector<std::vector<double>> Ensemble::predict_proba(std::vector<std::vector<int>>& X)
     {
         if (!fitted) {
@@ -81,6 +119,9 @@ namespace bayesnet {
     }
     torch::Tensor Ensemble::predict_average_proba(torch::Tensor& X)
     {
+        if (auto plan = getEnsemblePlan()) {
+            return plan->predict_proba(X, false);
+        }
         auto n_states = models[0]->getClassNumStates();
         torch::Tensor y_pred = torch::zeros({ X.size(1), n_states }, torch::kFloat32);
         for (auto i = 0; i < n_models; ++i) {
@@ -94,6 +135,9 @@ namespace bayesnet {
     }
     std::vector<std::vector<double>> Ensemble::predict_average_proba(std::vector<std::vector<int>>& X)
     {
+        if (auto plan = getEnsemblePlan()) {
+            return plan->predict_proba(X);
+        }
         auto n_states = models[0]->getClassNumStates();
         std::vector<std::vector<double>> y_pred(X[0].size(), std::vector<double>(n_states, 0.0));
         for (auto i = 0; i < n_models; ++i) {
@@ -122,6 +166,9 @@ namespace bayesnet {
     }
     torch::Tensor Ensemble::predict_average_voting(torch::Tensor& X)
     {
+        if (auto plan = getEnsemblePlan()) {
+            return plan->predict_proba(X, true);
+        }
         // Build a m x n_models tensor with the predictions of each model
         torch::Tensor y_pred = torch::zeros({ X.size(1), n_models }, torch::kInt32);
         for (auto i = 0; i < n_models; ++i) {
@@ -133,12 +180,7 @@ namespace bayesnet {
     float Ensemble::score(torch::Tensor& X, torch::Tensor& y)
     {
         auto y_pred = predict(X);
-        int correct = 0;
-        for (int i = 0; i < y_pred.size(0); ++i) {
-            if (y_pred[i].item<int>() == y[i].item<int>()) {
-                correct++;
-            }
-        }
+        int correct = (y_pred == y).sum().item<int>();
         return (double)correct / y_pred.size(0);
     }
     float Ensemble::score(std::vector<std::vector<int>>& X, std::vector<int>& y)
@@ -10,12 +10,15 @@
 #include "bayesnet/utils/BayesMetrics.h"
 #include "bayesnet/utils/bayesnetUtils.h"
 #include "bayesnet/classifiers/Classifier.h"
+#include "bayesnet/network/EnsemblePlan.h"
 
 namespace bayesnet {
     class Ensemble : public Classifier {
     public:
         Ensemble(bool predict_voting = true);
         virtual ~Ensemble() = default;
+        // Every model of the ensemble gets the new samples, the models and their significances are kept
+        Ensemble& partial_fit(torch::Tensor& X, torch::Tensor& y, const torch::Tensor& weights) override;
         torch::Tensor predict(torch::Tensor& X) override;
         std::vector<int> predict(std::vector<std::vector<int>>& X) override;
         torch::Tensor predict_proba(torch::Tensor& X) override;
@@ -49,11 +52,19 @@ namespace bayesnet {
         torch::Tensor compute_arg_max(torch::Tensor& X);
         std::vector<int> compute_arg_max(std::vector<std::vector<double>>& X);
         torch::Tensor voting(torch::Tensor& votes);
+        // Builds the fused plan of the trained models, predict only reads it
+        void finishFit() override;
+        // Fused plan of the models in use, null if some of them can't be fused or they changed after finishFit
+        const EnsemblePlan* getEnsemblePlan() const;
         // Attributes
         unsigned n_models;
         std::vector<std::unique_ptr<Classifier>> models;
         std::vector<double> significanceModels;
         bool predict_voting;
+    private:
+        std::shared_ptr<const EnsemblePlan> ensemblePlan; // built by finishFit and partial_fit
+        // Plans of the models in use, empty if some of them has no plan
+        std::vector<std::shared_ptr<const InferencePlan>> getModelPlans() const;
     };
 }
 #endif
@@ -0,0 +1,103 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#include <numeric>
+#include "bayesnet/utils/bayesnetUtils.h"
+#include "ProbabilityAccumulator.h"
+
+namespace bayesnet {
+    ProbabilityAccumulator::ProbabilityAccumulator(const torch::Tensor& X, int numClasses, bool voting)
+        : active(true), voting(voting), numClasses(numClasses), samples(X)
+    {
+        sum = accumulate(0, {});
+    }
+    ProbabilityAccumulator::ProbabilityAccumulator(const std::vector<std::vector<int>>& X, int numClasses, bool voting)
+        : active(true), voting(voting), numClasses(numClasses)
+    {
+        if (voting) {
+            // Ensemble votes with the tensor predictions of the models also for vectors
+            auto Xv = X;
+            samples = vectorToTensor(Xv, false);
+        } else {
+            vsamples = X;
+            doublePrecision = true;
+        }
+        sum = accumulate(0, {});
+    }
+    torch::Tensor ProbabilityAccumulator::contribution(Classifier& model)
+    {
+        if (voting) {
+            auto ypredict = model.predict(samples).to(torch::kInt64);
+            auto votes = torch::zeros({ ypredict.size(0), numClasses }, torch::kFloat64);
+            votes.scatter_(1, ypredict.unsqueeze(1), 1.0);
+            return votes;
+        }
+        if (doublePrecision) {
+            auto ypredict = model.predict_proba(vsamples);
+            auto result = torch::zeros({ static_cast<int64_t>(ypredict.size()), numClasses }, torch::kFloat64);
+            double* data = result.data_ptr<double>();
+            for (size_t i = 0; i < ypredict.size(); ++i) {
+                std::copy(ypredict[i].begin(), ypredict[i].end(), data + i * numClasses);
+            }
+            return result;
+        }
+        return model.predict_proba(samples);
+    }
+    // Sum of the contributions from first on with the given significances, in the precision of Ensemble
+    torch::Tensor ProbabilityAccumulator::accumulate(int first, const std::vector<double>& weights) const
+    {
+        const int64_t n_samples = doublePrecision ? (vsamples.empty() ? 0 : vsamples[0].size()) : samples.size(1);
+        // The votes are counted with doubles as Ensemble::voting does
+        auto result = torch::zeros({ n_samples, numClasses }, voting || doublePrecision ? torch::kFloat64 : torch::kFloat32);
+        for (size_t i = 0; i < weights.size(); ++i) {
+            result += contributions[first + i] * weights[i];
+        }
+        return result;
+    }
+    void ProbabilityAccumulator::add(const torch::Tensor& contribution, double significance)
+    {
+        contributions.push_back(contribution);
+        significances.push_back(significance);
+        sum += contribution * significance;
+    }
+    void ProbabilityAccumulator::removeLast()
+    {
+        sum -= contributions.back() * significances.back();
+        contributions.pop_back();
+        significances.pop_back();
+    }
+    void ProbabilityAccumulator::setSignificances(const std::vector<double>& newSignificances)
+    {
+        significances = newSignificances;
+        sum = accumulate(0, significances);
+    }
+    torch::Tensor ProbabilityAccumulator::argmax(torch::Tensor& values, const std::vector<double>& weights) const
+    {
+        auto total = std::reduce(weights.begin(), weights.end());
+        if (voting) {
+            // Ensemble::voting turns the votes to float before dividing
+            values = values.to(torch::kFloat32);
+        }
+        values /= total;
+        return torch::argmax(values, 1);
+    }
+    torch::Tensor ProbabilityAccumulator::predict(const torch::Tensor& extra, double significance) const
+    {
+        auto values = sum.clone();
+        auto weights = significances;
+        if (extra.defined()) {
+            values += extra * significance;
+            weights.push_back(significance);
+        }
+        return argmax(values, weights);
+    }
+    torch::Tensor ProbabilityAccumulator::predictLast(int k) const
+    {
+        std::vector<double> weights(k, 1.0);
+        auto values = accumulate(size() - k, weights);
+        return argmax(values, weights);
+    }
+}
@@ -0,0 +1,54 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#ifndef PROBABILITY_ACCUMULATOR_H
+#define PROBABILITY_ACCUMULATOR_H
+#include <vector>
+#include <torch/torch.h>
+#include "bayesnet/classifiers/Classifier.h"
+
+namespace bayesnet {
+    /*
+    Running weighted sum of the predictions of the models of an ensemble on a fixed set of samples.
+    The contribution of every model (its class probabilities, or its one hot votes when voting) is computed once
+    and kept, so the prediction of the ensemble with one more model costs O(samples x classes) and no model is
+    run again. The sums follow the order and precision of Ensemble::predict for the same kind of samples (tensor
+    or vectors), so the predictions are the same as the ones of the ensemble.
+    */
+    class ProbabilityAccumulator {
+    public:
+        ProbabilityAccumulator() = default;
+        // X is nxm, one column per sample
+        ProbabilityAccumulator(const torch::Tensor& X, int numClasses, bool voting);
+        ProbabilityAccumulator(const std::vector<std::vector<int>>& X, int numClasses, bool voting);
+        bool isActive() const { return active; }
+        int size() const { return static_cast<int>(contributions.size()); }
+        // Runs the model on the samples, the result can be added with add or used in predict
+        torch::Tensor contribution(Classifier& model);
+        void add(const torch::Tensor& contribution, double significance);
+        // Subtracts the contribution of the last model, the sums may differ in the last bits from summing the rest again
+        void removeLast();
+        // New significances of all the models, the sums are made again from the stored contributions
+        void setSignificances(const std::vector<double>& significances);
+        // Class predicted by the ensemble for every sample, adding extra with the given significance if it is defined
+        torch::Tensor predict(const torch::Tensor& extra = torch::Tensor(), double significance = 1.0) const;
+        // Class predicted by the last k models with significance 1
+        torch::Tensor predictLast(int k) const;
+    private:
+        torch::Tensor accumulate(int first, const std::vector<double>& significances) const;
+        torch::Tensor argmax(torch::Tensor& sum, const std::vector<double>& significances) const;
+        bool active = false;
+        bool voting = false;
+        bool doublePrecision = false; // the vector predictions of Ensemble are made with doubles
+        int numClasses = 0;
+        torch::Tensor samples;
+        std::vector<std::vector<int>> vsamples;
+        std::vector<torch::Tensor> contributions;
+        std::vector<double> significances;
+        torch::Tensor sum;
+    };
+}
+#endif
@@ -0,0 +1,309 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include "bayesnet/utils/ThreadPool.h"
+#include "XA2DE.h"
+
+namespace bayesnet {
+    XA2DE::XA2DE(bool predict_voting) : Classifier(Network()), predict_voting(predict_voting)
+    {
+        validHyperparameters = { "predict_voting" };
+    }
+    void XA2DE::setHyperparameters(const nlohmann::json& hyperparameters_)
+    {
+        auto hyperparameters = hyperparameters_;
+        if (hyperparameters.contains("predict_voting")) {
+            predict_voting = hyperparameters["predict_voting"];
+            hyperparameters.erase("predict_voting");
+        }
+        Classifier::setHyperparameters(hyperparameters);
+    }
+    void XA2DE::buildModel(const torch::Tensor& weights)
+    {
+        if (n < 2) {
+            throw std::invalid_argument("XA2DE needs at least two features");
+        }
+        cardinalities.clear();
+        for (const auto& feature : features) {
+            cardinalities.push_back(states.at(feature).size());
+        }
+        classStates = states.at(className).size();
+        // Tables of the triples i < j < k, tripleOffset[(i * n + j) * n + k] is the offset of the triple
+        triples.clear();
+        std::vector<int64_t> tripleOffset(static_cast<size_t>(n) * n * n, -1);
+        int64_t size = 0;
+        for (int i = 0; i < static_cast<int>(n); ++i) {
+            for (int j = i + 1; j < static_cast<int>(n); ++j) {
+                for (int k = j + 1; k < static_cast<int>(n); ++k) {
+                    triples.push_back({ i, j, k, size });
+                    tripleOffset[(static_cast<size_t>(i) * n + j) * n + k] = size;
+                    size += static_cast<int64_t>(cardinalities[i]) * cardinalities[j] * cardinalities[k] * classStates;
+                }
+            }
+        }
+        tripleCounts.assign(size, 0.0);
+        pairs.clear();
+        size = 0;
+        for (int i = 0; i < static_cast<int>(n); ++i) {
+            for (int j = i + 1; j < static_cast<int>(n); ++j) {
+                Pair pair{ i, j, size, {} };
+                size += static_cast<int64_t>(cardinalities[i]) * cardinalities[j] * classStates;
+                for (int k = 0; k < static_cast<int>(n); ++k) {
+                    if (k == i || k == j) {
+                        continue;
+                    }
+                    // Position of every feature in its triple, the strides of the table follow that order
+                    std::vector<int> triple = { i, j, k };
+                    std::sort(triple.begin(), triple.end());
+                    std::vector<int64_t> strides = { static_cast<int64_t>(cardinalities[triple[1]]) * cardinalities[triple[2]] * classStates, static_cast<int64_t>(cardinalities[triple[2]]) * classStates, classStates };
+                    auto stride = [&](int feature) { return strides[std::find(triple.begin(), triple.end(), feature) - triple.begin()]; };
+                    int64_t offset = tripleOffset[(static_cast<size_t>(triple[0]) * n + triple[1]) * n + triple[2]];
+                    pair.children.push_back({ k, offset, stride(i), stride(j), stride(k), 0.0, 0.0 });
+                }
+                pairs.push_back(std::move(pair));
+            }
+        }
+        pairCounts.assign(size, 0.0);
+        classCounts.assign(classStates, 0.0);
+        numSamples = 0;
+    }
+    void XA2DE::trainModel(const torch::Tensor& weights, const Smoothing_t smoothing)
+    {
+        this->smoothing = smoothing;
+        addCounts(dataset, weights);
+        setSmoothing();
+    }
+    // data is (n+1)xm with the class in the last row
+    void XA2DE::addCounts(const torch::Tensor& data, const torch::Tensor& weights)
+    {
+        const auto values = data.to(torch::kInt32).contiguous();
+        const auto weights_ = weights.to(torch::kFloat64).contiguous();
+        const int* values_ptr = values.data_ptr<int>();
+        const double* weights_ptr = weights_.data_ptr<double>();
+        const int64_t n_samples = values.size(1);
+        // Every value is checked before counting so a wrong sample leaves the counts untouched
+        for (int i = 0; i <= static_cast<int>(n); ++i) {
+            int numStates = i < static_cast<int>(n) ? cardinalities[i] : classStates;
+            const std::string& name = i < static_cast<int>(n) ? features[i] : className;
+            for (int64_t sample = 0; sample < n_samples; ++sample) {
+                int value = values_ptr[i * n_samples + sample];
+                if (value < 0 || value >= numStates) {
+                    throw std::out_of_range("Value " + std::to_string(value) + " out of range for the " + std::to_string(numStates) + " states of " + name);
+                }
+            }
+        }
+        const int* classes = values_ptr + n * n_samples;
+        for (int64_t sample = 0; sample < n_samples; ++sample) {
+            classCounts[classes[sample]] += weights_ptr[sample];
+        }
+        auto& pool = ThreadPool::getInstance();
+        pool.parallel_for(0, pairs.size(), 1, [&](int64_t begin, int64_t end) {
+            for (int64_t p = begin; p < end; ++p) {
+                const auto& pair = pairs[p];
+                const int* first = values_ptr + pair.first * n_samples;
+                const int* second = values_ptr + pair.second * n_samples;
+                double* counts = pairCounts.data() + pair.offset;
+                const int states = cardinalities[pair.second];
+                for (int64_t sample = 0; sample < n_samples; ++sample) {
+                    counts[(first[sample] * states + second[sample]) * classStates + classes[sample]] += weights_ptr[sample];
+                }
+            }
+            });
+        pool.parallel_for(0, triples.size(), 1, [&](int64_t begin, int64_t end) {
+            for (int64_t t = begin; t < end; ++t) {
+                const auto& triple = triples[t];
+                const int* first = values_ptr + triple.first * n_samples;
+                const int* second = values_ptr + triple.second * n_samples;
+                const int* third = values_ptr + triple.third * n_samples;
+                double* counts = tripleCounts.data() + triple.offset;
+                const int states2 = cardinalities[triple.second];
+                const int states3 = cardinalities[triple.third];
+                for (int64_t sample = 0; sample < n_samples; ++sample) {
+                    counts[((first[sample] * states2 + second[sample]) * states3 + third[sample]) * classStates + classes[sample]] += weights_ptr[sample];
+                }
+            }
+            });
+        numSamples += n_samples;
+    }
+    // Smoothing factors of Network::applySmoothing and the class priors
+    void XA2DE::setSmoothing()
+    {
+        auto factor = [this](int numStates) {
+            switch (smoothing) {
+                case Smoothing_t::ORIGINAL:
+                    return 1.0 / numSamples;
+                case Smoothing_t::LAPLACE:
+                    return 1.0;
+                case Smoothing_t::CESTNIK:
+                    return 1.0 / numStates;
+                default:
+                    return 0.0;
+            }
+            };
+        for (auto& pair : pairs) {
+            for (auto& child : pair.children) {
+                int numStates = cardinalities[child.feature];
+                child.smoothing = factor(numStates);
+                child.denominatorSmoothing = child.smoothing * numStates;
+            }
+        }
+        double classSmoothing = factor(classStates);
+        double total = std::accumulate(classCounts.begin(), classCounts.end(), 0.0) + classSmoothing * classStates;
+        priors.resize(classStates);
+        for (int c = 0; c < classStates; ++c) {
+            priors[c] = total > 0 ? (classCounts[c] + classSmoothing) / total : 0.0;
+        }
+    }
+    Classifier& XA2DE::partial_fit(torch::Tensor& X, torch::Tensor& y, const torch::Tensor& weights)
+    {
+        if (!fitted) {
+            throw std::logic_error(CLASSIFIER_NOT_FITTED);
+        }
+        if (X.size(0) != static_cast<int64_t>(n) || X.size(1) != y.size(0) || X.size(1) != weights.size(0)) {
+            throw std::invalid_argument("XA2DE::partial_fit: X must be " + std::to_string(n) + "xm with m labels and weights");
+        }
+        auto data = torch::cat({ X.to(torch::kInt32), y.to(torch::kInt32).view({ 1, -1 }) }, 0);
+        addCounts(data, weights);
+        m += X.size(1);
+        setSmoothing();
+        return *this;
+    }
+    void XA2DE::checkSamples(int64_t n_features) const
+    {
+        if (!fitted) {
+            throw std::logic_error(CLASSIFIER_NOT_FITTED);
+        }
+        if (n_features != static_cast<int64_t>(n)) {
+            throw std::invalid_argument("Sample size (" + std::to_string(n_features) + ") does not match the number of features (" + std::to_string(n) + ")");
+        }
+    }
+    void XA2DE::posterior(const int* sample, int64_t step, double* result, double* scratch) const
+    {
+        for (int f = 0; f < static_cast<int>(n); ++f) {
+            int value = sample[f * step];
+            if (value < 0 || value >= cardinalities[f]) {
+                throw std::out_of_range("Value " + std::to_string(value) + " out of range in sample column " + std::to_string(f));
+            }
+        }
+        std::fill(result, result + classStates, 0.0);
+        for (const auto& pair : pairs) {
+            const int64_t first = sample[pair.first * step];
+            const int64_t second = sample[pair.second * step];
+            const double* denominators = pairCounts.data() + pair.offset + (first * cardinalities[pair.second] + second) * classStates;
+            std::copy(priors.begin(), priors.end(), scratch);
+            for (const auto& child : pair.children) {
+                const double* numerators = tripleCounts.data() + child.offset + first * child.strideFirst + second * child.strideSecond + sample[child.feature * step] * child.strideChild;
+                double maxValue = 0.0;
+                for (int c = 0; c < classStates; ++c) {
+                    double denominator = denominators[c] + child.denominatorSmoothing;
+                    scratch[c] *= denominator > 0 ? (numerators[c] + child.smoothing) / denominator : 0.0;
+                    maxValue = std::max(maxValue, scratch[c]);
+                }
+                // Only the ratios between classes matter, keep the products away from underflow
+                if (maxValue > 0 && maxValue < 1e-200) {
+                    std::transform(scratch, scratch + classStates, scratch, [](double value) { return value * 1e200; });
+                }
+            }
+            double sum = std::accumulate(scratch, scratch + classStates, 0.0);
+            if (sum <= 0) {
+                continue;
+            }
+            if (predict_voting) {
+                result[std::max_element(scratch, scratch + classStates) - scratch] += 1.0;
+            } else {
+                for (int c = 0; c < classStates; ++c) {
+                    result[c] += scratch[c] / sum;
+                }
+            }
+        }
+        // Every pair has significance 1 as the SPnDEs of A2DE
+        const double total = static_cast<double>(pairs.size());
+        std::transform(result, result + classStates, result, [total](double value) { return value / total; });
+    }
+    torch::Tensor XA2DE::posteriors(torch::Tensor& X) const
+    {
+        checkSamples(X.size(0));
+        // One row per sample
+        const auto data = X.to(torch::kInt32).t().contiguous();
+        const int64_t n_samples = data.size(0);
+        const int* data_ptr = data.data_ptr<int>();
+        auto result = torch::zeros({ n_samples, classStates }, torch::kFloat64);
+        double* result_ptr = result.data_ptr<double>();
+        ThreadPool::getInstance().parallel_for(0, n_samples, [&](int64_t begin, int64_t end) {
+            std::vector<double> scratch(classStates);
+            for (int64_t row = begin; row < end; ++row) {
+                posterior(data_ptr + row * n, 1, result_ptr + row * classStates, scratch.data());
+            }
+            });
+        return result;
+    }
+    torch::Tensor XA2DE::predict_proba(torch::Tensor& X)
+    {
+        // Float probabilities as the A2DE ensemble
+        return posteriors(X).to(torch::kFloat32);
+    }
+    std::vector<std::vector<double>> XA2DE::predict_proba(std::vector<std::vector<int>>& X)
+    {
+        checkSamples(X.size());
+        const int64_t n_samples = X.empty() ? 0 : X[0].size();
+        std::vector<std::vector<double>> result(n_samples, std::vector<double>(classStates, 0.0));
+        ThreadPool::getInstance().parallel_for(0, n_samples, [&](int64_t begin, int64_t end) {
+            std::vector<int> sample(n);
+            std::vector<double> scratch(classStates);
+            for (int64_t row = begin; row < end; ++row) {
+                for (int f = 0; f < static_cast<int>(n); ++f) {
+                    sample[f] = X[f][row];
+                }
+                posterior(sample.data(), 1, result[row].data(), scratch.data());
+            }
+            });
+        return result;
+    }
+    torch::Tensor XA2DE::predict(torch::Tensor& X)
+    {
+        return posteriors(X).argmax(1);
+    }
+    std::vector<int> XA2DE::predict(std::vector<std::vector<int>>& X)
+    {
+        auto probabilities = predict_proba(X);
+        std::vector<int> predictions(probabilities.size());
+        for (size_t i = 0; i < probabilities.size(); ++i) {
+            predictions[i] = std::max_element(probabilities[i].begin(), probabilities[i].end()) - probabilities[i].begin();
+        }
+        return predictions;
+    }
+    float XA2DE::score(torch::Tensor& X, torch::Tensor& y)
+    {
+        auto y_pred = predict(X);
+        return (y_pred == y).sum().item<float>() / y.size(0);
+    }
+    float XA2DE::score(std::vector<std::vector<int>>& X, std::vector<int>& y)
+    {
+        auto y_pred = predict(X);
+        int correct = 0;
+        for (size_t i = 0; i < y_pred.size(); ++i) {
+            if (y_pred[i] == y[i]) {
+                correct++;
+            }
+        }
+        return static_cast<float>(correct) / y_pred.size();
+    }
+    int XA2DE::getNumberOfNodes() const
+    {
+        return pairs.size() * (n + 1);
+    }
+    int XA2DE::getNumberOfEdges() const
+    {
+        return pairs.size() * 3 * (n - 2);
+    }
+    int XA2DE::getNumberOfStates() const
+    {
+        return pairs.size() * (std::accumulate(cardinalities.begin(), cardinalities.end(), 0) + classStates);
+    }
+}
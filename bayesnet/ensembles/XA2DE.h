@@ -0,0 +1,85 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#ifndef XA2DE_H
+#define XA2DE_H
+#include <string>
+#include <vector>
+#include <torch/torch.h>
+#include "bayesnet/classifiers/Classifier.h"
+
+namespace bayesnet {
+    /*
+    A2DE without a network per pair of superparents.
+    The model is the same as A2DE: for every pair (i, j) of features the posterior is
+    p(c) * prod_k p(x_k | c, x_i, x_j) normalized, and the ensemble averages the posteriors of all the pairs
+    (or their votes). All the pairs share the count tables:
+    - N(c, x_i, x_j) for every pair i < j, the denominators of the conditional probabilities
+    - N(c, x_i, x_j, x_k) for every triple i < j < k, the numerators of p(x_k | c, x_i, x_j), p(x_j | c, x_i, x_k)
+      and p(x_i | c, x_j, x_k)
+    so the memory is a third of the per pair tables of A2DE and the probabilities are computed while scoring.
+    */
+    class XA2DE : public Classifier {
+    public:
+        explicit XA2DE(bool predict_voting = false);
+        virtual ~XA2DE() = default;
+        void setHyperparameters(const nlohmann::json& hyperparameters_) override;
+        // Adds the counts of new samples, weights are in the scale used by fit
+        Classifier& partial_fit(torch::Tensor& X, torch::Tensor& y, const torch::Tensor& weights) override;
+        torch::Tensor predict(torch::Tensor& X) override;
+        std::vector<int> predict(std::vector<std::vector<int>>& X) override;
+        torch::Tensor predict_proba(torch::Tensor& X) override;
+        std::vector<std::vector<double>> predict_proba(std::vector<std::vector<int>>& X) override;
+        float score(torch::Tensor& X, torch::Tensor& y) override;
+        float score(std::vector<std::vector<int>>& X, std::vector<int>& y) override;
+        // Same figures as the A2DE ensemble of SPnDEs
+        int getNumberOfNodes() const override;
+        int getNumberOfEdges() const override;
+        int getNumberOfStates() const override;
+        int getClassNumStates() const override { return classStates; }
+        std::vector<std::string> graph(const std::string& title = "XA2DE") const override { return { title }; }
+        std::vector<std::string> topological_order() override { return {}; }
+    protected:
+        void buildModel(const torch::Tensor& weights) override;
+        void trainModel(const torch::Tensor& weights, const Smoothing_t smoothing) override;
+    private:
+        // p(x_child | c, x_first, x_second) of one pair, read from the table of the triple of the three features
+        struct Child {
+            int feature;
+            int64_t offset; // table of the triple in tripleCounts
+            int64_t strideFirst, strideSecond, strideChild; // strides of the values in the table, the class is the last index
+            double smoothing, denominatorSmoothing; // smoothing of the child and smoothing times its number of states
+        };
+        struct Pair {
+            int first, second;
+            int64_t offset; // table in pairCounts, index (x_first * states[second] + x_second) * classStates + c
+            std::vector<Child> children;
+        };
+        struct Triple {
+            int first, second, third;
+            int64_t offset; // table in tripleCounts, index ((x_first * states[second] + x_second) * states[third] + x_third) * classStates + c
+        };
+        void addCounts(const torch::Tensor& data, const torch::Tensor& weights);
+        void setSmoothing();
+        void checkSamples(int64_t n_features) const;
+        // Average posterior (or vote shares) of all the pairs, sample[f * step] is the value of feature f
+        void posterior(const int* sample, int64_t step, double* result, double* scratch) const;
+        // mxclassStates double posteriors of the samples of X (nxm)
+        torch::Tensor posteriors(torch::Tensor& X) const;
+        bool predict_voting;
+        Smoothing_t smoothing = Smoothing_t::NONE;
+        int classStates = 0;
+        double numSamples = 0; // samples counted, used by the ORIGINAL smoothing
+        std::vector<int> cardinalities; // number of states of every feature
+        std::vector<double> classCounts;
+        std::vector<double> priors; // p(c)
+        std::vector<Pair> pairs;
+        std::vector<Triple> triples;
+        std::vector<double> pairCounts;
+        std::vector<double> tripleCounts;
+    };
+}
+#endif
@@ -5,6 +5,7 @@
 // ***************************************************************
 #include "XBAODE.h"
 #include "bayesnet/classifiers/XSPODE.h"
+#include "bayesnet/utils/MutualInformationRanker.h"
 #include "bayesnet/utils/TensorUtils.h"
 #include <limits.h>
 #include <random>
@@ -40,23 +41,22 @@ namespace bayesnet {
         bool finished = false;
         std::vector<int> featuresUsed;
         n_models = 0;
+        // Keep the predictions of the ensemble on the sets where it is evaluated after adding every model
+        int numClasses = states.at(className).size();
+        trainSums = alpha_block ? ProbabilityAccumulator(X_train_, numClasses, predict_voting) : ProbabilityAccumulator();
+        testSums = convergence ? ProbabilityAccumulator(X_test, numClasses, predict_voting) : ProbabilityAccumulator();
         if (selectFeatures) {
             featuresUsed = initializeModels(smoothing);
-            auto ypred = predict(X_train_);
-            auto ypred_t = torch::tensor(ypred);
+            auto ypred_t = trainSums.isActive() ? trainSums.predict() : torch::tensor(predict(X_train_));
             if (!weightless) {
                 std::tie(weights_, alpha_t, finished) = update_weights(y_train, ypred_t, weights_);
             }
             // Update significance of the models
-            for (const int& feature : featuresUsed) {
-                significanceModels.pop_back();
-            }
-            for (const int& feature : featuresUsed) {
-                significanceModels.push_back(alpha_t);
-            }
+            update_significances(0, alpha_t);
             // VLOG_SCOPE_F(1, "SelectFeatures. alpha_t: %f n_models: %d", alpha_t,
             // n_models);
             if (finished) {
+                trainSums = testSums = ProbabilityAccumulator();
                 return;
             }
         }
@@ -72,9 +72,14 @@ namespace bayesnet {
         // run out of features
         bool ascending = order_algorithm == bayesnet::Orders.ASC;
         std::mt19937 g{ 173 };
+        // The ranker keeps the histograms of the features and only recounts the samples reweighted between rankings
+        MutualInformationRanker ranker(dataset, weights_);
+        reweighted = torch::zeros({ m }, torch::kBool);
         while (!finished) {
             // Step 1: Build ranking with mutual information
-            auto featureSelection = metrics.SelectKBestWeighted(weights_, ascending, n); // Get all the features sorted
+            ranker.update(weights_, reweighted);
+            reweighted = torch::zeros({ m }, torch::kBool);
+            auto featureSelection = ranker.SelectKBest(ascending, n); // Get all the features sorted
             if (order_algorithm == bayesnet::Orders.RAND) {
                 std::shuffle(featureSelection.begin(), featureSelection.end(), g);
             }
@@ -102,36 +107,30 @@ namespace bayesnet {
                  /*std::cout << dynamic_cast<XSpode*>(model.get())->to_string() <<
                   * std::endl;*/
                   // DEBUG
-                std::vector<int> ypred;
+                torch::Tensor ypred_t, contribution;
                 if (alpha_block) {
                     //
                     // Compute the prediction with the current ensemble + model
                     //
-                    // Add the model to the ensemble
-                    add_model(std::move(model), 1.0);
-                    // Compute the prediction
-                    ypred = predict(X_train_);
-                    model = std::move(models.back());
-                    // Remove the model from the ensemble
-                    remove_last_model();
+                    contribution = trainSums.contribution(*model);
+                    ypred_t = trainSums.predict(contribution, 1.0);
                 } else {
-                    ypred = model->predict(X_train_);
+                    ypred_t = torch::tensor(model->predict(X_train_));
                 }
                 // Step 3.1: Compute the classifier amout of say
-                auto ypred_t = torch::tensor(ypred);
                 if (!weightless) {
                     std::tie(weights_, alpha_t, finished) = update_weights(y_train, ypred_t, weights_);
                 }
                 // Step 3.4: Store classifier and its accuracy to weigh its future vote
                 numItemsPack++;
                 featuresUsed.push_back(feature);
-                add_model(std::move(model), alpha_t);
+                add_model(std::move(model), alpha_t, contribution);
                 // VLOG_SCOPE_F(2, "finished: %d numItemsPack: %d n_models: %d
                 // featuresUsed: %zu", finished, numItemsPack, n_models,
                 // featuresUsed.size());
             } // End of the pack
             if (convergence && !finished) {
-                auto y_val_predict = predict(X_test);
+                auto y_val_predict = testSums.predict();
                 double accuracy = (y_val_predict == y_test).sum().item<double>() / (double)y_test.size(0);
                 if (priorAccuracy == 0) {
                     priorAccuracy = accuracy;
@@ -178,6 +177,7 @@ namespace bayesnet {
                 // n_models=%d numItemsPack=%d", n_models, numItemsPack);
             }
         }
+        trainSums = testSums = ProbabilityAccumulator();
         if (featuresUsed.size() != features.size()) {
             notes.push_back("Used features in train: " + std::to_string(featuresUsed.size()) + " of " +
                 std::to_string(features.size()));
@@ -35,6 +35,10 @@ namespace bayesnet {
         selectedScores.clear();
         suLabels.clear();
         suFeatures.clear();
+        suMatrix = torch::Tensor();
+        // The weights are the same for the whole fit, they are looked up in the cache only once
+        auto cache = getStatisticsCache();
+        weightsVersion = cache ? cache->getWeightsVersion(weights) : -1;
 
         fitted = false;
     }
@@ -73,10 +77,22 @@ namespace bayesnet {
         // Compute Symmetrical Uncertainty between each feature and the class labels
         // https://en.wikipedia.org/wiki/Symmetric_uncertainty
         const int classIdx = static_cast<int>(samples.size(0)) - 1; // labels in last row
-        suLabels.reserve(features.size());
-        for (int i = 0; i < static_cast<int>(features.size()); ++i) {
-            suLabels.emplace_back(symmetricalUncertainty(i, classIdx));
+        auto compute = [&]() {
+            std::vector<double> values;
+            values.reserve(features.size());
+            for (int i = 0; i < static_cast<int>(features.size()); ++i) {
+                values.emplace_back(symmetricalUncertainty(i, classIdx));
+            }
+            return values;
+        };
+        auto cache = getStatisticsCache();
+        if (!cache) {
+            suLabels = compute();
+            return;
         }
+        // Shared with the selectors of other classifiers fitted on the same samples and weights
+        auto values = cache->get("SU(Xi;C)", weightsVersion, [&]() { return torch::tensor(compute(), torch::kFloat64); }).contiguous();
+        suLabels.assign(values.data_ptr<double>(), values.data_ptr<double>() + values.numel());
     }
 
     //---------------------------------------------------------------------
@@ -91,6 +107,23 @@ namespace bayesnet {
         auto it = suFeatures.find(key);
         if (it != suFeatures.end()) return it->second;
 
+        if (auto cache = getStatisticsCache()) {
+            // All the pairs are one entry of the cache, shared with the selectors fitted on the same samples and weights
+            if (!suMatrix.defined()) {
+                suMatrix = cache->get("SU(Xi;Xj)", weightsVersion, [&]() {
+                    const int n = static_cast<int>(features.size());
+                    auto matrix = torch::zeros({ n, n }, torch::kFloat64);
+                    auto values = matrix.accessor<double, 2>();
+                    for (int i = 0; i < n; ++i) {
+                        for (int j = i + 1; j < n; ++j) {
+                            values[i][j] = values[j][i] = symmetricalUncertainty(i, j);
+                        }
+                    }
+                    return matrix;
+                    }).contiguous();
+            }
+            return suMatrix.data_ptr<double>()[key.first * suMatrix.size(1) + key.second];
+        }
         double result = symmetricalUncertainty(key.first, key.second);
         suFeatures[key] = result;  // store once (symmetry handled by ordering)
         return result;
@@ -30,6 +30,8 @@ namespace bayesnet {
         std::vector<double> selectedScores;
         std::vector<double> suLabels;
         std::map<std::pair<int, int>, double> suFeatures;
+        torch::Tensor suMatrix; // nxn SU of every pair of features, taken from the statistics cache if there is one
+        int64_t weightsVersion = -1; // version of the weights in the statistics cache, resolved by initialize
         bool fitted = false;
     };
 }
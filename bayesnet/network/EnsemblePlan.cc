@@ -0,0 +1,151 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include "bayesnet/utils/ThreadPool.h"
+#include "EnsemblePlan.h"
+
+namespace bayesnet {
+    EnsemblePlan::EnsemblePlan(const std::vector<std::shared_ptr<const InferencePlan>>& plans, const std::vector<double>& significances)
+        : plans(plans), significances(significances)
+    {
+        if (plans.empty() || plans.size() != significances.size()) {
+            throw std::invalid_argument("EnsemblePlan needs one significance for every one of at least one member");
+        }
+        classNumStates = plans[0]->classNumStates;
+        numFeatures = static_cast<int>(plans[0]->factors.size()) - 1;
+        for (const auto& plan : plans) {
+            if (plan->classNumStates != classNumStates || static_cast<int>(plan->factors.size()) - 1 != numFeatures) {
+                throw std::invalid_argument("The members of an EnsemblePlan must have the same features and class states");
+            }
+        }
+        for (size_t i = 0; i < plans.size(); ++i) {
+            const auto& plan = *plans[i];
+            members.push_back({ static_cast<int>(factors.size()), static_cast<int>(plan.factors.size()), plan.logSpace, significances[i] });
+            for (const auto& factor : plan.factors) {
+                factors.push_back({ factor.cpt, factor.classStride, static_cast<int>(columns.size()), static_cast<int>(factor.columns.size()) });
+                columns.insert(columns.end(), factor.columns.begin(), factor.columns.end());
+                strides.insert(strides.end(), factor.strides.begin(), factor.strides.end());
+                states.insert(states.end(), factor.states.begin(), factor.states.end());
+            }
+        }
+    }
+    bool EnsemblePlan::matches(const std::vector<std::shared_ptr<const InferencePlan>>& plans, const std::vector<double>& significances) const
+    {
+        return plans == this->plans && significances == this->significances;
+    }
+    void EnsemblePlan::checkFeatures(int64_t n_features) const
+    {
+        if (n_features != numFeatures) {
+            throw std::invalid_argument("Sample size (" + std::to_string(n_features) + ") does not match the number of features (" + std::to_string(numFeatures) + ")");
+        }
+    }
+    // Same computation as InferencePlan::predict
+    void EnsemblePlan::posterior(const Member& member, const int* sample, int64_t step, double* result) const
+    {
+        std::fill(result, result + classNumStates, member.logSpace ? 0.0 : 1.0);
+        for (int f = member.firstFactor; f < member.firstFactor + member.numFactors; ++f) {
+            const auto& factor = factors[f];
+            int64_t base = 0;
+            for (int i = factor.firstColumn; i < factor.firstColumn + factor.numColumns; ++i) {
+                int value = sample[columns[i] * step];
+                if (value < 0 || value >= states[i]) {
+                    throw std::out_of_range("Value " + std::to_string(value) + " out of range in sample column " + std::to_string(columns[i]));
+                }
+                base += value * strides[i];
+            }
+            const double* values = factor.cpt + base;
+            if (member.logSpace) {
+                for (int c = 0; c < classNumStates; ++c) {
+                    result[c] += values[c * factor.classStride];
+                }
+            } else {
+                for (int c = 0; c < classNumStates; ++c) {
+                    result[c] *= values[c * factor.classStride];
+                }
+            }
+        }
+        if (member.logSpace) {
+            double maxValue = *std::max_element(result, result + classNumStates);
+            if (maxValue == -std::numeric_limits<double>::infinity()) {
+                std::fill(result, result + classNumStates, 0.0);
+                return;
+            }
+            std::transform(result, result + classNumStates, result, [maxValue](const double& value) { return std::exp(value - maxValue); });
+        }
+        double sum = std::accumulate(result, result + classNumStates, 0.0);
+        if (sum == 0.0) {
+            return;
+        }
+        std::transform(result, result + classNumStates, result, [sum](const double& value) { return value / sum; });
+    }
+    torch::Tensor EnsemblePlan::predict_proba(const torch::Tensor& samples, bool voting) const
+    {
+        checkFeatures(samples.size(0));
+        // One row per sample so all the members read the same cache lines
+        const auto data = samples.to(torch::kInt32).t().contiguous();
+        const int64_t n_samples = data.size(0);
+        const int* data_ptr = data.data_ptr<int>();
+        auto result = torch::zeros({ n_samples, classNumStates }, torch::kFloat32);
+        float* result_ptr = result.data_ptr<float>();
+        const float total = static_cast<float>(std::reduce(significances.begin(), significances.end()));
+        ThreadPool::getInstance().parallel_for(0, n_samples, [&](int64_t begin, int64_t end) {
+            std::vector<double> probabilities(classNumStates);
+            std::vector<double> sums(classNumStates);
+            for (int64_t row = begin; row < end; ++row) {
+                const int* sample = data_ptr + row * numFeatures;
+                float* output = result_ptr + row * classNumStates;
+                std::fill(sums.begin(), sums.end(), 0.0);
+                for (const auto& member : members) {
+                    posterior(member, sample, 1, probabilities.data());
+                    if (voting) {
+                        // Votes are counted with doubles and the first class with the highest probability wins
+                        auto winner = std::max_element(probabilities.begin(), probabilities.end()) - probabilities.begin();
+                        sums[winner] += member.significance;
+                    } else {
+                        // The float sums of Ensemble::predict_average_proba
+                        for (int c = 0; c < classNumStates; ++c) {
+                            output[c] = static_cast<float>(output[c] + probabilities[c] * member.significance);
+                        }
+                    }
+                }
+                for (int c = 0; c < classNumStates; ++c) {
+                    output[c] = (voting ? static_cast<float>(sums[c]) : output[c]) / total;
+                }
+            }
+            });
+        return result;
+    }
+    std::vector<std::vector<double>> EnsemblePlan::predict_proba(const std::vector<std::vector<int>>& samples) const
+    {
+        checkFeatures(samples.size());
+        const int64_t n_samples = samples.empty() ? 0 : samples[0].size();
+        const double total = std::reduce(significances.begin(), significances.end());
+        std::vector<std::vector<double>> result(n_samples, std::vector<double>(classNumStates, 0.0));
+        ThreadPool::getInstance().parallel_for(0, n_samples, [&](int64_t begin, int64_t end) {
+            std::vector<int> sample(numFeatures);
+            std::vector<double> probabilities(classNumStates);
+            for (int64_t row = begin; row < end; ++row) {
+                for (int col = 0; col < numFeatures; ++col) {
+                    sample[col] = samples[col][row];
+                }
+                auto& output = result[row];
+                for (const auto& member : members) {
+                    posterior(member, sample.data(), 1, probabilities.data());
+                    for (int c = 0; c < classNumStates; ++c) {
+                        output[c] = output[c] + probabilities[c] * member.significance;
+                    }
+                }
+                std::transform(output.begin(), output.end(), output.begin(), [total](double x) { return x / total; });
+            }
+            });
+        return result;
+    }
+}
@@ -0,0 +1,58 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#ifndef ENSEMBLE_PLAN_H
+#define ENSEMBLE_PLAN_H
+#include <memory>
+#include <vector>
+#include "InferencePlan.h"
+
+namespace bayesnet {
+    /*
+    Fused inference of an ensemble of networks over the same features, e.g. the SPODEs of AODE and BoostAODE.
+    The factors of all the members are packed in one table that points to the CPTs of the member plans, so every
+    sample is scored by all the members in one pass and their posteriors are added weighted by the significances,
+    without building a tensor per member. The results follow Ensemble::predict_average_proba and Ensemble::predict_average_voting.
+    */
+    class EnsemblePlan {
+    public:
+        EnsemblePlan() = default;
+        EnsemblePlan(const std::vector<std::shared_ptr<const InferencePlan>>& plans, const std::vector<double>& significances);
+        // true if the plan was built with the same member plans and significances
+        bool matches(const std::vector<std::shared_ptr<const InferencePlan>>& plans, const std::vector<double>& significances) const;
+        int getClassNumStates() const { return classNumStates; }
+        // samples is nxm (one column per sample), returns mxclassNumStates float probabilities or vote shares
+        torch::Tensor predict_proba(const torch::Tensor& samples, bool voting) const;
+        // samples is nxm, returns the mxclassNumStates averaged probabilities
+        std::vector<std::vector<double>> predict_proba(const std::vector<std::vector<int>>& samples) const;
+    private:
+        struct Factor {
+            const double* cpt; // cpt of the factor in its member plan, kept alive by plans
+            int64_t classStride;
+            int firstColumn; // the columns of the factor are columns[firstColumn, firstColumn + numColumns)
+            int numColumns;
+        };
+        struct Member {
+            int firstFactor;
+            int numFactors;
+            bool logSpace;
+            double significance;
+        };
+        // Posterior of member into result, sample[i * step] is the value of the i-th feature
+        void posterior(const Member& member, const int* sample, int64_t step, double* result) const;
+        void checkFeatures(int64_t n_features) const;
+        std::vector<Factor> factors;
+        std::vector<Member> members;
+        std::vector<int> columns;
+        std::vector<int64_t> strides;
+        std::vector<int> states;
+        std::vector<std::shared_ptr<const InferencePlan>> plans; // owners of the cpts, also compared by matches
+        std::vector<double> significances;
+        int classNumStates = 0;
+        int numFeatures = 0;
+    };
+}
+#endif
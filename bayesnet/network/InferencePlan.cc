@@ -0,0 +1,129 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include "InferencePlan.h"
+
+namespace bayesnet {
+    InferencePlan::InferencePlan(const std::vector<Node*>& nodes, const std::vector<std::vector<int>>& parents, int classId, int classNumStates, bool logSpace)
+        : classNumStates(classNumStates), logSpace(logSpace)
+    {
+        factors.reserve(nodes.size());
+        for (size_t id = 0; id < nodes.size(); ++id) {
+            Factor factor;
+            auto cpt = nodes[id]->getCPT().contiguous();
+            auto sizes = cpt.sizes();
+            std::vector<int64_t> strides(sizes.size(), 1);
+            for (int i = static_cast<int>(strides.size()) - 2; i >= 0; --i) {
+                strides[i] = strides[i + 1] * sizes[i + 1];
+            }
+            // Order of indices in the cpt is 0-> node variable, 1-> 1st parent, 2-> 2nd parent, ...
+            std::vector<int> variables = { static_cast<int>(id) };
+            variables.insert(variables.end(), parents[id].begin(), parents[id].end());
+            for (size_t i = 0; i < variables.size(); ++i) {
+                if (variables[i] == classId) {
+                    factor.classStride = strides[i];
+                    continue;
+                }
+                factor.columns.push_back(variables[i]);
+                factor.strides.push_back(strides[i]);
+                factor.states.push_back(static_cast<int>(sizes[i]));
+            }
+            factor.table = logSpace ? cpt.log().reshape({ -1 }) : cpt.reshape({ -1 });
+            factor.cpt = factor.table.data_ptr<double>();
+            factors.push_back(std::move(factor));
+        }
+    }
+    void InferencePlan::predict(const int* sample, int64_t step, double* result) const
+    {
+        std::fill(result, result + classNumStates, logSpace ? 0.0 : 1.0);
+        for (const auto& factor : factors) {
+            int64_t base = 0;
+            for (size_t i = 0; i < factor.columns.size(); ++i) {
+                int value = sample[factor.columns[i] * step];
+                if (value < 0 || value >= factor.states[i]) {
+                    throw std::out_of_range("Value " + std::to_string(value) + " out of range in sample column " + std::to_string(factor.columns[i]));
+                }
+                base += value * factor.strides[i];
+            }
+            const double* values = factor.cpt + base;
+            if (logSpace) {
+                for (int c = 0; c < classNumStates; ++c) {
+                    result[c] += values[c * factor.classStride];
+                }
+            } else {
+                for (int c = 0; c < classNumStates; ++c) {
+                    result[c] *= values[c * factor.classStride];
+                }
+            }
+        }
+        if (logSpace) {
+            // log-sum-exp: shift by the maximum before leaving log space
+            double maxValue = *std::max_element(result, result + classNumStates);
+            if (maxValue == -std::numeric_limits<double>::infinity()) {
+                // every class has probability 0, same result as in linear space
+                std::fill(result, result + classNumStates, 0.0);
+                return;
+            }
+            std::transform(result, result + classNumStates, result, [maxValue](const double& value) { return std::exp(value - maxValue); });
+        }
+        // Normalize result, a sample with probability 0 for every class keeps the zeros
+        double sum = std::accumulate(result, result + classNumStates, 0.0);
+        if (sum == 0.0) {
+            return;
+        }
+        std::transform(result, result + classNumStates, result, [sum](const double& value) { return value / sum; });
+    }
+    std::vector<double> InferencePlan::predict(const std::vector<int>& sample) const
+    {
+        std::vector<double> result(classNumStates);
+        predict(sample.data(), 1, result.data());
+        return result;
+    }
+    torch::Tensor InferencePlan::predict(const torch::Tensor& samples) const
+    {
+        const auto data = samples.to(torch::kInt64);
+        const int64_t n_samples = data.size(1);
+        auto classOffsets = torch::arange(classNumStates, torch::kInt64);
+        auto result = logSpace ? torch::zeros({ n_samples, classNumStates }, torch::kFloat64) : torch::ones({ n_samples, classNumStates }, torch::kFloat64);
+        std::vector<bool> checked(data.size(0), false);
+        for (const auto& factor : factors) {
+            // Flat cpt index of every sample with the class set to 0
+            auto base = torch::zeros({ n_samples }, torch::kInt64);
+            for (size_t i = 0; i < factor.columns.size(); ++i) {
+                auto values = data.select(0, factor.columns[i]);
+                if (!checked[factor.columns[i]]) {
+                    auto invalid = (values < 0).logical_or(values >= factor.states[i]);
+                    if (invalid.any().item<bool>()) {
+                        int value = values.masked_select(invalid)[0].item<int>();
+                        throw std::out_of_range("Value " + std::to_string(value) + " out of range in sample column " + std::to_string(factor.columns[i]));
+                    }
+                    checked[factor.columns[i]] = true;
+                }
+                base += values * factor.strides[i];
+            }
+            auto index = base.unsqueeze(1) + classOffsets * factor.classStride;
+            auto values = factor.table.index_select(0, index.view(-1)).view({ n_samples, classNumStates });
+            if (logSpace) {
+                result += values;
+            } else {
+                result *= values;
+            }
+        }
+        // Samples with probability 0 for every class get zeros as in the scalar path
+        if (logSpace) {
+            auto norm = result.logsumexp(1, true);
+            return torch::where(torch::isinf(norm), torch::zeros_like(result), (result - norm).exp());
+        }
+        // Normalize result
+        auto sum = result.sum(1, true);
+        return torch::where(sum == 0, torch::zeros_like(result), result / sum);
+    }
+}
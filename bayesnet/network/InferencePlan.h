@@ -0,0 +1,48 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#ifndef INFERENCE_PLAN_H
+#define INFERENCE_PLAN_H
+#include <vector>
+#include "Node.h"
+
+namespace bayesnet {
+    /*
+    Compiled view of a fitted network used for exact inference.
+    Every node is turned into a flat view of its CPT plus the sample columns and strides
+    needed to address it, so scoring a sample is pointer arithmetic only.
+    The plan is immutable once built and can be shared between threads and networks.
+    In log space the CPTs hold log probabilities, factors are added and the posterior is
+    normalized with log-sum-exp, so it does not underflow with many features.
+    */
+    class InferencePlan {
+    public:
+        InferencePlan() = default;
+        // nodes are indexed by id and sample column i holds the value of node i, parents[i] are the ids of the parents of node i
+        InferencePlan(const std::vector<Node*>& nodes, const std::vector<std::vector<int>>& parents, int classId, int classNumStates, bool logSpace = false);
+        int getClassNumStates() const { return classNumStates; }
+        bool isLogSpace() const { return logSpace; }
+        // sample[i * step] is the value of the i-th feature, result must hold classNumStates values
+        void predict(const int* sample, int64_t step, double* result) const;
+        std::vector<double> predict(const std::vector<int>& sample) const;
+        // Whole batch inference, samples is nxm (one column per sample), returns mxclassNumStates probabilities
+        torch::Tensor predict(const torch::Tensor& samples) const;
+    private:
+        friend class EnsemblePlan; // packs the factors of several plans
+        struct Factor {
+            std::vector<int> columns; // sample column of every non class variable in the factor
+            std::vector<int64_t> strides; // stride in cpt of every column
+            std::vector<int> states; // number of states of every column
+            int64_t classStride = 0; // stride in cpt of the class variable, 0 if not in the factor
+            torch::Tensor table; // flat cpt, same order as Node::getCPT() and sharing its storage, log probabilities in log space
+            const double* cpt = nullptr; // data of table
+        };
+        std::vector<Factor> factors;
+        int classNumStates = 0;
+        bool logSpace = false;
+    };
+}
+#endif
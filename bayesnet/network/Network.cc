@@ -4,28 +4,25 @@
 // SPDX-License-Identifier: MIT
 // ***************************************************************
 
-#include <thread>
 #include <sstream>
 #include <numeric>
 #include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
 #include "Network.h"
 #include "bayesnet/utils/bayesnetUtils.h"
-#include "bayesnet/utils/CountingSemaphore.h"
-#include <pthread.h>
+#include "bayesnet/utils/ContingencyTable.h"
+#include "bayesnet/utils/ThreadPool.h"
 #include <fstream>
 namespace bayesnet {
-    Network::Network() : fitted{ false }, classNumStates{ 0 }
+    Network::Network() : fitted{ false }, logSpace{ false }, smoothing{ Smoothing_t::NONE }, classNumStates{ 0 }
     {
     }
     Network::Network(const Network& other) 
         : features(other.features), className(other.className), classNumStates(other.classNumStates),
-          fitted(other.fitted)
+          fitted(other.fitted), logSpace(other.logSpace), smoothing(other.smoothing), plan(other.plan),
+          samples(other.samples), numSamples(other.numSamples) // samples shared with other until getSamples() gives write access to them
     {
-        // Deep copy the samples tensor
-        if (other.samples.defined()) {
-            samples = other.samples.clone();
-        }
-        
         // First, create all nodes (without relationships)
         for (const auto& node : other.nodes) {
             nodes[node.first] = std::make_unique<Node>(*node.second);
@@ -53,6 +50,55 @@ namespace bayesnet {
                 }
             }
         }
+        buildIndex();
+    }
+    // Rebuilds the id based view of the nodes and edges from the map
+    void Network::buildIndex()
+    {
+        nodeList.clear();
+        nodeIds.clear();
+        for (int id = 0; id < static_cast<int>(features.size()); ++id) {
+            nodeList.push_back(nodes.at(features[id]).get());
+            nodeIds[features[id]] = id;
+        }
+        parentIds.assign(nodeList.size(), {});
+        childIds.assign(nodeList.size(), {});
+        for (int id = 0; id < static_cast<int>(nodeList.size()); ++id) {
+            for (const auto& parent : nodeList[id]->getParents()) {
+                parentIds[id].push_back(nodeIds.at(parent->getName()));
+            }
+            for (const auto& child : nodeList[id]->getChildren()) {
+                childIds[id].push_back(nodeIds.at(child->getName()));
+            }
+        }
+        buildOrder();
+    }
+    // Topological order of the whole graph with the Kahn algorithm, the nodes without pending parents are taken by id
+    void Network::buildOrder()
+    {
+        const int n = nodeList.size();
+        std::vector<int> pendingParents(n);
+        std::vector<int> ready;
+        for (int id = n - 1; id >= 0; --id) {
+            pendingParents[id] = parentIds[id].size();
+            if (pendingParents[id] == 0) {
+                ready.push_back(id);
+            }
+        }
+        position.assign(n, 0);
+        marks.assign(n, 0);
+        sortedValid = false;
+        int next = 0;
+        while (!ready.empty()) {
+            int id = ready.back();
+            ready.pop_back();
+            position[id] = next++;
+            for (int child : childIds[id]) {
+                if (--pendingParents[child] == 0) {
+                    ready.push_back(child);
+                }
+            }
+        }
     }
     
     Network& Network::operator=(const Network& other)
@@ -64,13 +110,13 @@ namespace bayesnet {
             className = other.className;
             classNumStates = other.classNumStates;
             fitted = other.fitted;
+            logSpace = other.logSpace;
+            smoothing = other.smoothing;
+            plan = other.plan;
             
-            // Deep copy the samples tensor
-            if (other.samples.defined()) {
-                samples = other.samples.clone();
-            } else {
-                samples = torch::Tensor();
-            }
+            // The samples are shared with other until getSamples() gives write access to them
+            samples = other.samples;
+            numSamples = other.numSamples;
             
             // First, create all nodes (without relationships)
             for (const auto& node : other.nodes) {
@@ -99,6 +145,7 @@ namespace bayesnet {
                     }
                 }
             }
+            buildIndex();
         }
         return *this;
     }
@@ -108,11 +155,49 @@ namespace bayesnet {
         className = "";
         classNumStates = 0;
         fitted = false;
+        smoothing = Smoothing_t::NONE;
         nodes.clear();
+        nodeList.clear();
+        nodeIds.clear();
+        parentIds.clear();
+        childIds.clear();
+        position.clear();
+        marks.clear();
+        sorted.clear();
+        sortedValid = false;
         samples = torch::Tensor();
+        numSamples = 0;
+        plan.reset();
+    }
+    void Network::setLogSpace(bool logSpace)
+    {
+        this->logSpace = logSpace;
+        if (fitted) {
+            compilePlan();
+        }
+    }
+    bool Network::getLogSpace() const
+    {
+        return logSpace;
+    }
+    void Network::setSmoothing(const Smoothing_t smoothing)
+    {
+        if (!fitted) {
+            throw std::logic_error("You must call fit() before calling setSmoothing()");
+        }
+        this->smoothing = smoothing;
+        applySmoothing();
+    }
+    Smoothing_t Network::getSmoothing() const
+    {
+        return smoothing;
     }
     torch::Tensor& Network::getSamples()
     {
+        // Copy on write, the caller may change the samples in place
+        if (samples.defined() && samples.use_count() > 1) {
+            samples = samples.clone();
+        }
         return samples;
     }
     void Network::addNode(const std::string& name)
@@ -126,10 +211,15 @@ namespace bayesnet {
         if (nodes.find(name) != nodes.end()) {
             return;
         }
-        if (find(features.begin(), features.end(), name) == features.end()) {
-            features.push_back(name);
-        }
+        features.push_back(name);
         nodes[name] = std::make_unique<Node>(name);
+        nodeIds[name] = static_cast<int>(nodeList.size());
+        nodeList.push_back(nodes[name].get());
+        parentIds.emplace_back();
+        childIds.emplace_back();
+        position.push_back(static_cast<int>(position.size()));
+        marks.push_back(0);
+        sortedValid = false;
     }
     std::vector<std::string> Network::getFeatures() const
     {
@@ -142,8 +232,8 @@ namespace bayesnet {
     int Network::getStates() const
     {
         int result = 0;
-        for (auto& node : nodes) {
-            result += node.second->getNumStates();
+        for (const auto& node : nodeList) {
+            result += node->getNumStates();
         }
         return result;
     }
@@ -151,21 +241,73 @@ namespace bayesnet {
     {
         return className;
     }
-    bool Network::isCyclic(const std::string& nodeId, std::unordered_set<std::string>& visited, std::unordered_set<std::string>& recStack)
-    {
-        if (visited.find(nodeId) == visited.end()) // if node hasn't been visited yet
-        {
-            visited.insert(nodeId);
-            recStack.insert(nodeId);
-            for (Node* child : nodes[nodeId]->getChildren()) {
-                if (visited.find(child->getName()) == visited.end() && isCyclic(child->getName(), visited, recStack))
-                    return true;
-                if (recStack.find(child->getName()) != recStack.end())
-                    return true;
+    /*
+    Pearce-Kelly online topological order: an edge that goes forward in the order keeps it as is, otherwise only the
+    nodes placed between the child and the parent are searched. The nodes reachable from the child (the parent among
+    them means a cycle) are moved after the nodes that reach the parent, reusing the positions they had.
+    */
+    bool Network::orderEdge(int parentId, int childId)
+    {
+        if (parentId == childId) {
+            return false;
+        }
+        const int lower = position[childId];
+        const int upper = position[parentId];
+        if (upper < lower) {
+            return true;
+        }
+        std::vector<int> forward = { childId };
+        marks[childId] = 1;
+        bool cycle = false;
+        for (size_t i = 0; i < forward.size() && !cycle; ++i) {
+            for (int child : childIds[forward[i]]) {
+                if (child == parentId) {
+                    cycle = true;
+                    break;
+                }
+                if (!marks[child] && position[child] < upper) {
+                    marks[child] = 1;
+                    forward.push_back(child);
+                }
+            }
+        }
+        if (cycle) {
+            for (int id : forward) {
+                marks[id] = 0;
             }
+            return false;
+        }
+        std::vector<int> backward = { parentId };
+        marks[parentId] = 1;
+        for (size_t i = 0; i < backward.size(); ++i) {
+            for (int parent : parentIds[backward[i]]) {
+                if (!marks[parent] && position[parent] > lower) {
+                    marks[parent] = 1;
+                    backward.push_back(parent);
+                }
+            }
+        }
+        auto byPosition = [this](int left, int right) { return position[left] < position[right]; };
+        std::sort(forward.begin(), forward.end(), byPosition);
+        std::sort(backward.begin(), backward.end(), byPosition);
+        std::vector<int> positions;
+        for (int id : backward) {
+            positions.push_back(position[id]);
+        }
+        for (int id : forward) {
+            positions.push_back(position[id]);
+        }
+        std::sort(positions.begin(), positions.end());
+        size_t next = 0;
+        for (int id : backward) {
+            position[id] = positions[next++];
+            marks[id] = 0;
         }
-        recStack.erase(nodeId); // remove node from recursion stack before function ends
-        return false;
+        for (int id : forward) {
+            position[id] = positions[next++];
+            marks[id] = 0;
+        }
+        return true;
     }
     void Network::addEdge(const std::string& parent, const std::string& child)
     {
@@ -178,24 +320,21 @@ namespace bayesnet {
         if (nodes.find(child) == nodes.end()) {
             throw std::invalid_argument("Child node " + child + " does not exist");
         }
+        int parentId = nodeIds.at(parent);
+        int childId = nodeIds.at(child);
         // Check if the edge is already in the graph
-        for (auto& node : nodes[parent]->getChildren()) {
-            if (node->getName() == child) {
-                throw std::invalid_argument("Edge " + parent + " -> " + child + " already exists");
-            }
+        if (find(childIds[parentId].begin(), childIds[parentId].end(), childId) != childIds[parentId].end()) {
+            throw std::invalid_argument("Edge " + parent + " -> " + child + " already exists");
         }
-        // Temporarily add edge to check for cycles
-        nodes[parent]->addChild(nodes[child].get());
-        nodes[child]->addParent(nodes[parent].get());
-        std::unordered_set<std::string> visited;
-        std::unordered_set<std::string> recStack;
-        if (isCyclic(nodes[child]->getName(), visited, recStack)) // if adding this edge forms a cycle
-        {
-            // remove problematic edge
-            nodes[parent]->removeChild(nodes[child].get());
-            nodes[child]->removeParent(nodes[parent].get());
+        // The edge closes a cycle if the parent can already be reached from the child
+        if (!orderEdge(parentId, childId)) {
             throw std::invalid_argument("Adding this edge forms a cycle in the graph.");
         }
+        sortedValid = false;
+        nodeList[parentId]->addChild(nodeList[childId]);
+        nodeList[childId]->addParent(nodeList[parentId]);
+        childIds[parentId].push_back(childId);
+        parentIds[childId].push_back(parentId);
     }
     std::map<std::string, std::unique_ptr<Node>>& Network::getNodes()
     {
@@ -233,10 +372,10 @@ namespace bayesnet {
     void Network::setStates(const std::map<std::string, std::vector<int>>& states)
     {
         // Set states to every Node in the network
-        for_each(features.begin(), features.end(), [this, &states](const std::string& feature) {
-            nodes.at(feature)->setNumStates(states.at(feature).size());
-            });
-        classNumStates = nodes.at(className)->getNumStates();
+        for (int id = 0; id < static_cast<int>(features.size()); ++id) {
+            nodeList[id]->setNumStates(states.at(features[id]).size());
+        }
+        classNumStates = nodeList[nodeIds.at(className)]->getNumStates();
     }
     // X comes in nxm, where n is the number of features and m the number of samples
     void Network::fit(const torch::Tensor& X, const torch::Tensor& y, const torch::Tensor& weights, const std::vector<std::string>& featureNames, const std::string& className, const std::map<std::string, std::vector<int>>& states, const Smoothing_t smoothing)
@@ -271,20 +410,89 @@ namespace bayesnet {
         samples.index_put_({ -1, "..." }, torch::tensor(labels, torch::kInt32));
         completeFit(states, weights, smoothing);
     }
+    void Network::partial_fit(const torch::Tensor& X, const torch::Tensor& y, const torch::Tensor& weights)
+    {
+        if (!fitted) {
+            throw std::logic_error("You must call fit() before calling partial_fit()");
+        }
+        if (X.size(0) != features.size() - 1) {
+            throw std::invalid_argument("X and local features must have the same number of features in Network::partial_fit (" + std::to_string(X.size(0)) + " != " + std::to_string(features.size() - 1) + ")");
+        }
+        if (X.size(1) != y.size(0)) {
+            throw std::invalid_argument("X and y must have the same number of samples in Network::partial_fit (" + std::to_string(X.size(1)) + " != " + std::to_string(y.size(0)) + ")");
+        }
+        if (X.size(1) != weights.size(0)) {
+            throw std::invalid_argument("Weights (" + std::to_string(weights.size(0)) + ") must have the same number of elements as samples (" + std::to_string(X.size(1)) + ") in Network::partial_fit");
+        }
+        torch::Tensor ytmp = torch::transpose(y.view({ y.size(0), 1 }), 0, 1);
+        auto data = torch::cat({ X, ytmp }, 0).to(samples.scalar_type());
+        accumulateCounts(data, weights);
+        numSamples += X.size(1);
+        applySmoothing();
+    }
+    void Network::merge(const Network& other)
+    {
+        if (!fitted || !other.fitted) {
+            throw std::logic_error("You must call fit() on both networks before calling merge()");
+        }
+        if (features != other.features || className != other.className || !(*this == other)) {
+            throw std::invalid_argument("Networks must have the same features and edges to be merged");
+        }
+        for (int id = 0; id < static_cast<int>(nodeList.size()); ++id) {
+            if (nodeList[id]->getNumStates() != other.nodeList[id]->getNumStates()) {
+                throw std::invalid_argument("Node " + features[id] + " has a different number of states in the networks to be merged");
+            }
+        }
+        for (int id = 0; id < static_cast<int>(nodeList.size()); ++id) {
+            const Node& otherNode = *other.nodeList[id];
+            nodeList[id]->getCounts() += otherNode.getCounts();
+        }
+        numSamples += other.numSamples;
+        applySmoothing();
+    }
+    void Network::fit_sharded(const torch::Tensor& samples, const torch::Tensor& weights, const std::vector<std::string>& featureNames, const std::string& className, const std::map<std::string, std::vector<int>>& states, const Smoothing_t smoothing, int nShards)
+    {
+        checkFitData(samples.size(1), samples.size(0) - 1, samples.size(1), featureNames, className, states, weights);
+        if (nShards < 1) {
+            throw std::invalid_argument("The number of shards must be positive in Network::fit_sharded (" + std::to_string(nShards) + ")");
+        }
+        const int64_t n_samples = samples.size(1);
+        nShards = static_cast<int>(std::min<int64_t>(nShards, std::max<int64_t>(1, n_samples)));
+        const int64_t shardSize = std::max<int64_t>(1, (n_samples + nShards - 1) / nShards);
+        nShards = static_cast<int>(std::max<int64_t>(1, (n_samples + shardSize - 1) / shardSize)); // no empty shards
+        // Shard 0 is fitted in this network, the rest in copies of its structure
+        std::vector<Network> shards(nShards - 1, *this);
+        ThreadPool::getInstance().parallel_for(0, nShards, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t shard = begin; shard < end; ++shard) {
+                int64_t from = shard * shardSize;
+                int64_t size = std::min(shardSize, n_samples - from);
+                Network& target = shard == 0 ? *this : shards[shard - 1];
+                target.fit(samples.narrow(1, from, size), weights.narrow(0, from, size), featureNames, className, states, smoothing);
+            }
+            });
+        for (const auto& shard : shards) {
+            merge(shard);
+        }
+        this->samples = samples;
+    }
     void Network::completeFit(const std::map<std::string, std::vector<int>>& states, const torch::Tensor& weights, const Smoothing_t smoothing)
     {
         setStates(states);
-        std::vector<std::thread> threads;
-        auto& semaphore = CountingSemaphore::getInstance();
-        const double n_samples = static_cast<double>(samples.size(1));
-        auto worker = [&](std::pair<const std::string, std::unique_ptr<Node>>& node, int i) {
-            std::string threadName = "FitWorker-" + std::to_string(i);
-#if defined(__linux__)
-            pthread_setname_np(pthread_self(), threadName.c_str());
-#else
-            pthread_setname_np(threadName.c_str());
-#endif
-            double numStates = static_cast<double>(node.second->getNumStates());
+        this->smoothing = smoothing;
+        for (auto& node : nodeList) {
+            node->initCounts();
+        }
+        accumulateCounts(samples, weights);
+        numSamples = samples.size(1);
+        applySmoothing();
+        fitted = true;
+    }
+    // Sets the smoothing of every node and compiles the inference plan, the CPTs are normalized from the counts
+    void Network::applySmoothing()
+    {
+        const double n_samples = static_cast<double>(numSamples);
+        for (auto& node : nodeList) {
+            double numStates = static_cast<double>(node->getNumStates());
             double smoothing_factor;
             switch (smoothing) {
                 case Smoothing_t::ORIGINAL:
@@ -299,18 +507,91 @@ namespace bayesnet {
                 default:
                     smoothing_factor = 0.0; // No smoothing 
             }
-            node.second->computeCPT(samples, features, smoothing_factor, weights);
-            semaphore.release();
-            };
-        int i = 0;
-        for (auto& node : nodes) {
-            semaphore.acquire();
-            threads.emplace_back(worker, std::ref(node), i++);
+            node->setSmoothing(smoothing_factor);
         }
-        for (auto& thread : threads) {
-            thread.join();
+        compilePlan();
+    }
+    // The plan shares the storage of the CPTs of the nodes, in log space it holds their logarithms
+    // and the CPTs of the nodes are freed, they are normalized from the counts again if they are requested
+    void Network::compilePlan()
+    {
+        plan = std::make_shared<const InferencePlan>(nodeList, parentIds, nodeIds.at(className), classNumStates, logSpace);
+        if (logSpace) {
+            for (auto& node : nodeList) {
+                node->releaseCPT();
+            }
         }
-        fitted = true;
+    }
+    // Adds the weight of every sample (column of data) to its cell in the counts of every node.
+    // The data is scanned once in blocks of samples that stay in cache while all the nodes of a worker are counted.
+    void Network::accumulateCounts(const torch::Tensor& data, const torch::Tensor& weights)
+    {
+        const auto values = data.to(torch::kInt32).contiguous();
+        const auto weights_ = weights.to(torch::kFloat64).contiguous();
+        const int* values_ptr = values.data_ptr<int>();
+        const double* weights_ptr = weights_.data_ptr<double>();
+        const int64_t n_samples = values.size(1);
+        // Every value is checked before counting so a wrong sample leaves the counts untouched
+        for (int i = 0; i < static_cast<int>(features.size()); ++i) {
+            auto row = values.select(0, i);
+            int numStates = nodeList[i]->getNumStates();
+            auto invalid = (row < 0).logical_or(row >= numStates);
+            if (invalid.any().item<bool>()) {
+                int value = row.masked_select(invalid)[0].item<int>();
+                throw std::out_of_range("Value " + std::to_string(value) + " out of range for the " + std::to_string(numStates) + " states of " + features[i]);
+            }
+        }
+        struct Counter {
+            std::vector<const int*> rows; // data row of the node and its parents
+            std::vector<int64_t> strides;
+            std::vector<int> states;
+            double* counts;
+            int64_t size;
+        };
+        std::vector<Counter> counters;
+        for (int id = 0; id < static_cast<int>(nodeList.size()); ++id) {
+            // Order of indices in the counts is 0-> node variable, 1-> 1st parent, 2-> 2nd parent, ...
+            std::vector<int> variables = { id };
+            variables.insert(variables.end(), parentIds[id].begin(), parentIds[id].end());
+            auto& nodeCounts = nodeList[id]->getCounts();
+            Counter counter;
+            counter.strides.resize(variables.size(), 1);
+            for (int i = static_cast<int>(variables.size()) - 2; i >= 0; --i) {
+                counter.strides[i] = counter.strides[i + 1] * nodeCounts.size(i + 1);
+            }
+            for (size_t i = 0; i < variables.size(); ++i) {
+                counter.rows.push_back(values_ptr + variables[i] * n_samples);
+                counter.states.push_back(nodeCounts.size(i));
+            }
+            counter.counts = nodeCounts.data_ptr<double>();
+            counter.size = nodeCounts.numel();
+            counters.push_back(std::move(counter));
+        }
+        const int64_t block = 8192;
+        auto& pool = ThreadPool::getInstance();
+        const int64_t chunk = (counters.size() + pool.getNumThreads() - 1) / pool.getNumThreads();
+        pool.parallel_for(0, counters.size(), chunk, [&](int64_t first, int64_t last) {
+            for (int64_t begin = 0; begin < n_samples; begin += block) {
+                int64_t end = std::min(begin + block, n_samples);
+                for (int64_t c = first; c < last; ++c) {
+                    const auto& counter = counters[c];
+                    if (counter.rows.size() <= 3) {
+                        // Node with up to two parents: histogram kernel of ContingencyTable
+                        const auto& rows = counter.rows;
+                        ContingencyTable::accumulate(rows[0] + begin, rows.size() > 1 ? rows[1] + begin : nullptr, rows.size() > 2 ? rows[2] + begin : nullptr,
+                            weights_ptr + begin, end - begin, rows.size() > 1 ? counter.states[1] : 1, rows.size() > 2 ? counter.states[2] : 1, counter.counts, counter.size);
+                        continue;
+                    }
+                    for (int64_t sample = begin; sample < end; ++sample) {
+                        int64_t index = 0;
+                        for (size_t v = 0; v < counter.rows.size(); ++v) {
+                            index += counter.rows[v][sample] * counter.strides[v];
+                        }
+                        counter.counts[index] += weights_ptr[sample];
+                    }
+                }
+            }
+            });
     }
     torch::Tensor Network::predict_tensor(const torch::Tensor& samples, const bool proba)
     {
@@ -322,34 +603,8 @@ namespace bayesnet {
             throw std::invalid_argument("(T) Sample size (" + std::to_string(samples.size(0)) +
                 ") does not match the number of features (" + std::to_string(features.size() - 1) + ")");
         }
-        torch::Tensor result;
-        std::vector<std::thread> threads;
-        std::mutex mtx;
-        auto& semaphore = CountingSemaphore::getInstance();
-        result = torch::zeros({ samples.size(1), classNumStates }, torch::kFloat64);
-        auto worker = [&](const torch::Tensor& sample, int i) {
-            std::string threadName = "PredictWorker-" + std::to_string(i);
-#if defined(__linux__)
-            pthread_setname_np(pthread_self(), threadName.c_str());
-#else
-            pthread_setname_np(threadName.c_str());
-#endif
-            auto psample = predict_sample(sample);
-            auto temp = torch::tensor(psample, torch::kFloat64);
-            {
-                std::lock_guard<std::mutex> lock(mtx);
-                result.index_put_({ i, "..." }, temp);
-            }
-            semaphore.release();
-            };
-        for (int i = 0; i < samples.size(1); ++i) {
-            semaphore.acquire();
-            const torch::Tensor sample = samples.index({ "...", i });
-            threads.emplace_back(worker, sample, i);
-        }
-        for (auto& thread : threads) {
-            thread.join();
-        }
+        // The whole batch is scored at once, column i of the nxm tensor is the i-th sample
+        auto result = plan->predict(samples);
         if (proba)
             return result;
         return result.argmax(1);
@@ -379,33 +634,17 @@ namespace bayesnet {
                 ") does not match the number of features (" + std::to_string(features.size() - 1) + ")");
         }
         std::vector<int> predictions(tsamples[0].size(), 0);
-        std::vector<int> sample;
-        std::vector<std::thread> threads;
-        auto& semaphore = CountingSemaphore::getInstance();
-        auto worker = [&](const std::vector<int>& sample, const int row, int& prediction) {
-            std::string threadName = "(V)PWorker-" + std::to_string(row);
-#if defined(__linux__)
-            pthread_setname_np(pthread_self(), threadName.c_str());
-#else
-            pthread_setname_np(threadName.c_str());
-#endif
-            auto classProbabilities = predict_sample(sample);
-            auto maxElem = max_element(classProbabilities.begin(), classProbabilities.end());
-            int predictedClass = distance(classProbabilities.begin(), maxElem);
-            prediction = predictedClass;
-            semaphore.release();
-            };
-        for (int row = 0; row < tsamples[0].size(); ++row) {
-            sample.clear();
-            for (int col = 0; col < tsamples.size(); ++col) {
-                sample.push_back(tsamples[col][row]);
+        ThreadPool::getInstance().parallel_for(0, tsamples[0].size(), [&](int64_t begin, int64_t end) {
+            std::vector<int> sample(tsamples.size());
+            for (int64_t row = begin; row < end; ++row) {
+                for (int col = 0; col < tsamples.size(); ++col) {
+                    sample[col] = tsamples[col][row];
+                }
+                auto classProbabilities = predict_sample(sample);
+                auto maxElem = max_element(classProbabilities.begin(), classProbabilities.end());
+                predictions[row] = distance(classProbabilities.begin(), maxElem);
             }
-            semaphore.acquire();
-            threads.emplace_back(worker, sample, row, std::ref(predictions[row]));
-        }
-        for (auto& thread : threads) {
-            thread.join();
-        }
+            });
         return predictions;
     }
     // Return mxn std::vector of probabilities
@@ -421,31 +660,15 @@ namespace bayesnet {
                 ") does not match the number of features (" + std::to_string(features.size() - 1) + ")");
         }
         std::vector<std::vector<double>> predictions(tsamples[0].size(), std::vector<double>(classNumStates, 0.0));
-        std::vector<int> sample;
-        std::vector<std::thread> threads;
-        auto& semaphore = CountingSemaphore::getInstance();
-        auto worker = [&](const std::vector<int>& sample, int row, std::vector<double>& predictions) {
-            std::string threadName = "(V)PWorker-" + std::to_string(row);
-#if defined(__linux__)
-            pthread_setname_np(pthread_self(), threadName.c_str());
-#else
-            pthread_setname_np(threadName.c_str());
-#endif
-            std::vector<double> classProbabilities = predict_sample(sample);
-            predictions = classProbabilities;
-            semaphore.release();
-            };
-        for (int row = 0; row < tsamples[0].size(); ++row) {
-            sample.clear();
-            for (int col = 0; col < tsamples.size(); ++col) {
-                sample.push_back(tsamples[col][row]);
+        ThreadPool::getInstance().parallel_for(0, tsamples[0].size(), [&](int64_t begin, int64_t end) {
+            std::vector<int> sample(tsamples.size());
+            for (int64_t row = begin; row < end; ++row) {
+                for (int col = 0; col < tsamples.size(); ++col) {
+                    sample[col] = tsamples[col][row];
+                }
+                predictions[row] = predict_sample(sample);
             }
-            semaphore.acquire();
-            threads.emplace_back(worker, sample, row, std::ref(predictions[row]));
-        }
-        for (auto& thread : threads) {
-            thread.join();
-        }
+            });
         return predictions;
     }
     double Network::score(const std::vector<std::vector<int>>& tsamples, const std::vector<int>& labels)
@@ -462,37 +685,7 @@ namespace bayesnet {
     // Return 1xn std::vector of probabilities
     std::vector<double> Network::predict_sample(const std::vector<int>& sample)
     {
-        std::map<std::string, int> evidence;
-        for (int i = 0; i < sample.size(); ++i) {
-            evidence[features[i]] = sample[i];
-        }
-        return exactInference(evidence);
-    }
-    // Return 1xn std::vector of probabilities
-    std::vector<double> Network::predict_sample(const torch::Tensor& sample)
-    {
-        std::map<std::string, int> evidence;
-        for (int i = 0; i < sample.size(0); ++i) {
-            evidence[features[i]] = sample[i].item<int>();
-        }
-        return exactInference(evidence);
-    }
-    std::vector<double> Network::exactInference(std::map<std::string, int>& evidence)
-    {
-        std::vector<double> result(classNumStates, 0.0);
-        auto completeEvidence = std::map<std::string, int>(evidence);
-        for (int i = 0; i < classNumStates; ++i) {
-            completeEvidence[getClassName()] = i;
-            double partial = 1.0;
-            for (auto& node : getNodes()) {
-                partial *= node.second->getFactorValue(completeEvidence);
-            }
-            result[i] = partial;
-        }
-        // Normalize result
-        double sum = std::accumulate(result.begin(), result.end(), 0.0);
-        transform(result.begin(), result.end(), result.begin(), [sum](const double& value) { return value / sum; });
-        return result;
+        return plan->predict(sample);
     }
     std::vector<std::string> Network::show() const
     {
@@ -537,38 +730,53 @@ namespace bayesnet {
     {
         return getEdges().size();
     }
+    // Cached until the graph changes. The order is the one of the previous swap based sort (move every father before its
+    // son until no move is needed) that the local discretization of the Ld models depends on
     std::vector<std::string> Network::topological_sort()
     {
         /* Check if al the fathers of every node are before the node */
-        auto result = features;
-        result.erase(remove(result.begin(), result.end(), className), result.end());
+        const int classId = nodeIds.at(className);
+        if (sortedValid && sortedClassName == className) {
+            return sorted;
+        }
+        std::vector<int> order;
+        std::vector<int> place(nodeList.size(), -1); // position of every node in order, -1 for the class
+        for (int id = 0; id < static_cast<int>(nodeList.size()); ++id) {
+            if (id != classId) {
+                place[id] = order.size();
+                order.push_back(id);
+            }
+        }
         bool ending{ false };
         while (!ending) {
             ending = true;
-            for (auto feature : features) {
-                auto fathers = nodes[feature]->getParents();
-                for (const auto& father : fathers) {
-                    auto fatherName = father->getName();
-                    if (fatherName == className) {
+            for (int id = 0; id < static_cast<int>(nodeList.size()); ++id) {
+                if (id == classId) {
+                    continue;
+                }
+                for (int father : parentIds[id]) {
+                    if (father == classId || place[father] < place[id]) {
                         continue;
                     }
-                    // Check if father is placed before the actual feature
-                    auto it = find(result.begin(), result.end(), fatherName);
-                    if (it != result.end()) {
-                        auto it2 = find(result.begin(), result.end(), feature);
-                        if (it2 != result.end()) {
-                            if (distance(it, it2) < 0) {
-                                // if it is not, insert it before the feature
-                                result.erase(remove(result.begin(), result.end(), fatherName), result.end());
-                                result.insert(it2, fatherName);
-                                ending = false;
-                            }
-                        }
+                    // Check if father is placed before the actual feature, if it is not, insert it before the feature
+                    int from = place[id];
+                    int to = place[father];
+                    order.erase(order.begin() + to);
+                    order.insert(order.begin() + from, father);
+                    for (int i = from; i <= to; ++i) {
+                        place[order[i]] = i;
                     }
+                    ending = false;
                 }
             }
         }
-        return result;
+        sorted.clear();
+        for (int id : order) {
+            sorted.push_back(features[id]);
+        }
+        sortedClassName = className;
+        sortedValid = true;
+        return sorted;
     }
     std::string Network::dump_cpt() const
     {
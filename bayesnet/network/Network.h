@@ -7,9 +7,11 @@
 #ifndef NETWORK_H
 #define NETWORK_H
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include "bayesnet/config.h"
 #include "Node.h"
+#include "InferencePlan.h"
 #include "Smoothing.h"
 
 namespace bayesnet {
@@ -30,12 +32,28 @@ namespace bayesnet {
         int getNumEdges() const;
         int getClassNumStates() const;
         std::string getClassName() const;
+        // Store the compiled CPTs as log probabilities and normalize the posteriors with log-sum-exp
+        void setLogSpace(bool logSpace);
+        bool getLogSpace() const;
+        // Compiled CPTs of the fitted network, a new plan is built every time the CPTs change
+        std::shared_ptr<const InferencePlan> getInferencePlan() const { return plan; }
+        // Renormalize the CPTs of a fitted network from the stored counts, no pass over the data is needed
+        void setSmoothing(const Smoothing_t smoothing);
+        Smoothing_t getSmoothing() const;
         /*
         Notice: Nodes have to be inserted in the same order as they are in the dataset, i.e., first node is first column and so on.
         */
         void fit(const std::vector<std::vector<int>>& input_data, const std::vector<int>& labels, const std::vector<double>& weights, const std::vector<std::string>& featureNames, const std::string& className, const std::map<std::string, std::vector<int>>& states, const Smoothing_t smoothing);
         void fit(const torch::Tensor& X, const torch::Tensor& y, const torch::Tensor& weights, const std::vector<std::string>& featureNames, const std::string& className, const std::map<std::string, std::vector<int>>& states, const Smoothing_t smoothing);
         void fit(const torch::Tensor& samples, const torch::Tensor& weights, const std::vector<std::string>& featureNames, const std::string& className, const std::map<std::string, std::vector<int>>& states, const Smoothing_t smoothing);
+        // Adds the weighted counts of new samples (X nxm, y m) to a fitted network, the structure does not change.
+        // Only the counts are updated, the new samples are not kept in getSamples()
+        void partial_fit(const torch::Tensor& X, const torch::Tensor& y, const torch::Tensor& weights);
+        // Adds the counts of another fitted network with the same structure, as if it had been fitted with both datasets
+        void merge(const Network& other);
+        int64_t getNumSamples() const { return numSamples; } // Number of samples counted by fit, partial_fit and merge
+        // Fits nShards copies of the network on consecutive slices of the samples in parallel and merges them
+        void fit_sharded(const torch::Tensor& samples, const torch::Tensor& weights, const std::vector<std::string>& featureNames, const std::string& className, const std::map<std::string, std::vector<int>>& states, const Smoothing_t smoothing, int nShards);
         std::vector<int> predict(const std::vector<std::vector<int>>&); // Return mx1 std::vector of predictions
         torch::Tensor predict(const torch::Tensor&); // Return mx1 tensor of predictions
         torch::Tensor predict_tensor(const torch::Tensor& samples, const bool proba);
@@ -50,17 +68,36 @@ namespace bayesnet {
         inline std::string version() { return  { project_version.begin(), project_version.end() }; }
         bool operator==(const Network& other) const;
     private:
-        std::map<std::string, std::unique_ptr<Node>> nodes;
+        std::map<std::string, std::unique_ptr<Node>> nodes; // owns the nodes, the map by name is kept for the public api
+        // Nodes by id, the id of a node is the position of its feature in features, i.e. its row in samples
+        std::vector<Node*> nodeList;
+        std::unordered_map<std::string, int> nodeIds;
+        std::vector<std::vector<int>> parentIds; // same order as Node::getParents()
+        std::vector<std::vector<int>> childIds;
+        // Topological order of the nodes kept by the Pearce-Kelly online algorithm, every edge goes from a lower
+        // to a higher position, position[id] is the position of the node id
+        std::vector<int> position;
+        std::vector<char> marks; // visited flags of the searches of addEdge, cleared after every search
+        std::vector<std::string> sorted; // result of topological_sort() for sortedClassName, valid until the graph changes
+        std::string sortedClassName;
+        bool sortedValid = false;
         bool fitted;
+        bool logSpace;
+        Smoothing_t smoothing;
         int classNumStates;
         std::vector<std::string> features; // Including classname
         std::string className;
         torch::Tensor samples; // n+1xm tensor used to fit the model
-        bool isCyclic(const std::string&, std::unordered_set<std::string>&, std::unordered_set<std::string>&);
+        int64_t numSamples = 0; // samples counted in the model, including the ones added by partial_fit and merge
+        std::shared_ptr<const InferencePlan> plan; // compiled after fit, shared between copies of the network
+        bool orderEdge(int parentId, int childId);
+        void buildOrder();
+        void buildIndex();
         std::vector<double> predict_sample(const std::vector<int>&);
-        std::vector<double> predict_sample(const torch::Tensor&);
-        std::vector<double> exactInference(std::map<std::string, int>&);
         void completeFit(const std::map<std::string, std::vector<int>>& states, const torch::Tensor& weights, const Smoothing_t smoothing);
+        void accumulateCounts(const torch::Tensor& data, const torch::Tensor& weights);
+        void applySmoothing();
+        void compilePlan();
         void checkFitData(int n_samples, int n_features, int n_samples_y, const std::vector<std::string>& featureNames, const std::string& className, const std::map<std::string, std::vector<int>>& states, const torch::Tensor& weights);
         void setStates(const std::map<std::string, std::vector<int>>&);
     };
@@ -15,12 +15,11 @@ namespace bayesnet {
     }
     
     Node::Node(const Node& other)
-        : name(other.name), numStates(other.numStates), dimensions(other.dimensions)
+        : name(other.name), numStates(other.numStates), dimensions(other.dimensions), smoothing(other.smoothing), cptUpdated(other.cptUpdated)
     {
-        // Deep copy the CPT tensor
-        if (other.cpTable.defined()) {
-            cpTable = other.cpTable.clone();
-        }
+        // The CPT and counts tensors are shared with other until one of them changes its counts (see getCounts)
+        cpTable = other.cpTable;
+        counts = other.counts;
         // Note: parent and children pointers are NOT copied here
         // They will be reconstructed by the Network copy constructor
         // to maintain proper object relationships
@@ -32,13 +31,12 @@ namespace bayesnet {
             name = other.name;
             numStates = other.numStates;
             dimensions = other.dimensions;
+            smoothing = other.smoothing;
+            cptUpdated = other.cptUpdated;
             
-            // Deep copy the CPT tensor
-            if (other.cpTable.defined()) {
-                cpTable = other.cpTable.clone();
-            } else {
-                cpTable = torch::Tensor();
-            }
+            // The CPT and counts tensors are shared with other until one of them changes its counts (see getCounts)
+            cpTable = other.cpTable;
+            counts = other.counts;
             
             // Clear existing relationships
             parents.clear();
@@ -53,6 +51,9 @@ namespace bayesnet {
         parents.clear();
         children.clear();
         cpTable = torch::Tensor();
+        counts = torch::Tensor();
+        smoothing = 0.0;
+        cptUpdated = false;
         dimensions.clear();
         numStates = 0;
     }
@@ -94,8 +95,41 @@ namespace bayesnet {
     }
     torch::Tensor& Node::getCPT()
     {
+        if (!cptUpdated && counts.defined()) {
+            cpTable = counts + smoothing;
+            // Normalize the counts (dividing each row by the sum of the row)
+            cpTable /= cpTable.sum(0, true);
+            cptUpdated = true;
+        }
         return cpTable;
     }
+    void Node::releaseCPT()
+    {
+        cpTable = torch::Tensor();
+        cptUpdated = false;
+    }
+    torch::Tensor& Node::getCounts()
+    {
+        // Copy on write: the caller may change the counts, so they stop being shared with the copies of this node
+        if (counts.defined() && counts.use_count() > 1) {
+            counts = counts.clone();
+        }
+        cptUpdated = false;
+        return counts;
+    }
+    const torch::Tensor& Node::getCounts() const
+    {
+        return counts;
+    }
+    void Node::setSmoothing(const double smoothing)
+    {
+        this->smoothing = smoothing;
+        cptUpdated = false;
+    }
+    double Node::getSmoothing() const
+    {
+        return smoothing;
+    }
     /*
      The MinFill criterion is a heuristic for variable elimination.
      The variable that minimizes the number of edges that need to be added to the graph to make it triangulated.
@@ -126,7 +160,7 @@ namespace bayesnet {
         }
         return result;
     }
-    void Node::computeCPT(const torch::Tensor& dataset, const std::vector<std::string>& features, const double smoothing, const torch::Tensor& weights)
+    void Node::initCounts()
     {
         dimensions.clear();
         dimensions.reserve(parents.size() + 1);
@@ -134,7 +168,13 @@ namespace bayesnet {
         for (const auto& parent : parents) {
             dimensions.push_back(parent->getNumStates());
         }
-        cpTable = torch::full(dimensions, smoothing, torch::kDouble);
+        counts = torch::zeros(dimensions, torch::kDouble);
+        cptUpdated = false;
+    }
+    void Node::computeCPT(const torch::Tensor& dataset, const std::vector<std::string>& features, const double smoothing, const torch::Tensor& weights)
+    {
+        initCounts();
+        setSmoothing(smoothing);
 
         // Build feature index map
         std::unordered_map<std::string, int> featureIndexMap;
@@ -156,7 +196,7 @@ namespace bayesnet {
         // Manual flattening of indices
         std::vector<int64_t> strides(all_indices.size(), 1);
         for (int i = strides.size() - 2; i >= 0; --i) {
-            strides[i] = strides[i + 1] * cpTable.size(i + 1);
+            strides[i] = strides[i + 1] * counts.size(i + 1);
         }
         auto indices_tensor_cpu = indices_tensor.cpu();
         auto indices_accessor = indices_tensor_cpu.accessor<int64_t, 2>();
@@ -169,14 +209,11 @@ namespace bayesnet {
             flat_indices[i] = idx;
         }
 
-        // Accumulate weights into flat CPT
-        auto flat_cpt = cpTable.flatten();
+        // Accumulate weights into flat counts, the CPT is normalized when it is requested
+        auto flat_counts = counts.flatten();
         auto flat_indices_tensor = torch::from_blob(flat_indices.data(), { (int64_t)flat_indices.size() }, torch::kLong).clone();
-        flat_cpt.index_add_(0, flat_indices_tensor, weights.cpu());
-        cpTable = flat_cpt.view(cpTable.sizes());
-
-        // Normalize the counts (dividing each row by the sum of the row)
-        cpTable /= cpTable.sum(0, true);
+        flat_counts.index_add_(0, flat_indices_tensor, weights.cpu());
+        counts = flat_counts.view(counts.sizes());
     }
     double Node::getFactorValue(std::map<std::string, int>& evidence)
     {
@@ -184,7 +221,7 @@ namespace bayesnet {
         // following predetermined order of indices in the cpTable (see Node.h)
         coordinates.push_back(at::tensor(evidence[name]));
         transform(parents.begin(), parents.end(), std::back_inserter(coordinates), [&evidence](const auto& parent) { return at::tensor(evidence[parent->getName()]); });
-        return cpTable.index({ coordinates }).item<double>();
+        return getCPT().index({ coordinates }).item<double>();
     }
     std::vector<std::string> Node::graph(const std::string& className)
     {
@@ -25,8 +25,14 @@ namespace bayesnet {
         std::string getName() const;
         std::vector<Node*>& getParents();
         std::vector<Node*>& getChildren();
-        torch::Tensor& getCPT();
+        torch::Tensor& getCPT(); // normalized from the counts on first access after the counts or the smoothing change, shared with the copies of the node so it is read only
+        void releaseCPT(); // frees the cached CPT, it is normalized again from the counts if it is requested
+        torch::Tensor& getCounts(); // weighted counts without smoothing, accessing them marks the CPT as outdated and unshares them from the copies of the node
+        const torch::Tensor& getCounts() const;
         void computeCPT(const torch::Tensor& dataset, const std::vector<std::string>& features, const double smoothing, const torch::Tensor& weights);
+        void initCounts(); // zeroed counts with the shape of the node and its parents
+        void setSmoothing(const double smoothing);
+        double getSmoothing() const;
         int getNumStates() const;
         void setNumStates(int);
         unsigned minFill();
@@ -38,6 +44,9 @@ namespace bayesnet {
         std::vector<Node*> children;
         int numStates = 0; // number of states of the variable
         torch::Tensor cpTable; // Order of indices is 0-> node variable, 1-> 1st parent, 2-> 2nd parent, ...
+        torch::Tensor counts; // same shape as cpTable
+        double smoothing = 0.0; // added to every count before normalizing
+        bool cptUpdated = false; // cpTable matches counts and smoothing
         std::vector<int64_t> dimensions; // dimensions of the cpTable
         std::vector<std::pair<std::string, std::string>> combinations(const std::vector<std::string>&);
     };
@@ -4,10 +4,15 @@
 // SPDX-License-Identifier: MIT
 // ***************************************************************
 
-#include <map>
-#include <unordered_map>
+#include <cmath>
+#include <limits>
+#include <numeric>
 #include <tuple>
+#include <stdexcept>
+#include "ContingencyTable.h"
 #include "Mst.h"
+#include "bayesnetUtils.h"
+#include "ThreadPool.h"
 #include "BayesMetrics.h"
 namespace bayesnet {
     //samples is n+1xm tensor used to fit the model
@@ -30,85 +35,346 @@ namespace bayesnet {
         }
         samples.index_put_({ -1, "..." }, torch::tensor(labels, torch::kInt32));
     }
-    std::vector<std::pair<int, int>> Metrics::SelectKPairs(const torch::Tensor& weights, std::vector<int>& featuresExcluded, bool ascending, unsigned k)
+    void Metrics::setApproximation(int64_t sampleSize, double confidence)
     {
-        // Return the K Best features 
-        auto n = features.size();
-        // compute scores
-        scoresKPairs.clear();
-        pairsKBest.clear();
-        auto labels = samples.index({ -1, "..." });
-        for (int i = 0; i < n - 1; ++i) {
-            if (std::find(featuresExcluded.begin(), featuresExcluded.end(), i) != featuresExcluded.end()) {
+        if (sampleSize < 0) {
+            throw std::invalid_argument("The approximation sample size can not be negative");
+        }
+        if (confidence <= 0 || confidence >= 1) {
+            throw std::invalid_argument("The approximation confidence must be in (0, 1)");
+        }
+        approximationSize = sampleSize;
+        // Two sided normal quantile of the confidence, erfc is decreasing
+        double low = 0, high = 40;
+        for (int iteration = 0; iteration < 100; ++iteration) {
+            double middle = (low + high) / 2;
+            if (std::erfc(middle / std::sqrt(2.0)) > 1 - confidence) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+        quantile = (low + high) / 2;
+    }
+    bool Metrics::approximate() const
+    {
+        return approximationSize > 0 && samples.size(1) > approximationSize;
+    }
+    // Systematic sampling with probability proportional to the weight inside every class: each class gets a share of
+    // the subsample proportional to its total weight and every selected sample weighs the same, so the weighted class
+    // distribution is kept and the subsample estimates the weighted distribution of the features
+    std::pair<torch::Tensor, torch::Tensor> Metrics::subsample(const torch::Tensor& data, const torch::Tensor& weights) const
+    {
+        const int64_t n_samples = data.size(1);
+        const int* labels = data.data_ptr<int>() + (data.size(0) - 1) * n_samples;
+        const double* weights_ptr = weights.data_ptr<double>();
+        std::vector<std::vector<int64_t>> strata;
+        std::vector<double> totals;
+        for (int64_t sample = 0; sample < n_samples; ++sample) {
+            if (weights_ptr[sample] <= 0) {
+                continue;
+            }
+            if (labels[sample] >= static_cast<int>(strata.size())) {
+                strata.resize(labels[sample] + 1);
+                totals.resize(labels[sample] + 1, 0.0);
+            }
+            strata[labels[sample]].push_back(sample);
+            totals[labels[sample]] += weights_ptr[sample];
+        }
+        const double total = std::accumulate(totals.begin(), totals.end(), 0.0);
+        std::vector<int64_t> indices;
+        std::vector<double> sampleWeights;
+        for (size_t value = 0; value < strata.size(); ++value) {
+            if (strata[value].empty()) {
                 continue;
             }
-            for (int j = i + 1; j < n; ++j) {
-                if (std::find(featuresExcluded.begin(), featuresExcluded.end(), j) != featuresExcluded.end()) {
+            const int64_t size = std::max<int64_t>(1, std::llround(approximationSize * totals[value] / total));
+            const double step = totals[value] / size;
+            double accumulated = 0;
+            auto sample = strata[value].begin();
+            for (int64_t drawn = 0; drawn < size; ++drawn) {
+                const double point = (drawn + 0.5) * step;
+                while (accumulated + weights_ptr[*sample] < point && sample + 1 != strata[value].end()) {
+                    accumulated += weights_ptr[*sample];
+                    ++sample;
+                }
+                indices.push_back(*sample);
+                sampleWeights.push_back(step);
+            }
+        }
+        auto index = torch::tensor(indices, torch::kInt64);
+        return { data.index_select(1, index).contiguous(), torch::tensor(sampleWeights, torch::kFloat64) };
+    }
+    // Half width of the confidence interval of a plug-in estimate computed with n samples from a table with the
+    // given number of cells: normal interval of the mean of the information density plus its first order bias
+    double Metrics::halfWidth(double variance, int64_t cells, int64_t n) const
+    {
+        return quantile * std::sqrt(std::max(variance, 0.0) / n) + static_cast<double>(cells) / (2.0 * n);
+    }
+    // Mean and variance of log p(x,c) - log p(x) - log p(c) over a table counts[x][c], the mean is I(X;C)
+    static std::pair<double, double> mutualInformationMoments(const std::vector<double>& counts, int statesX, int statesC)
+    {
+        std::vector<double> marginalX(statesX, 0.0), marginalC(statesC, 0.0);
+        double total = 0;
+        for (int x = 0; x < statesX; ++x) {
+            for (int c = 0; c < statesC; ++c) {
+                marginalX[x] += counts[x * statesC + c];
+                marginalC[c] += counts[x * statesC + c];
+            }
+            total += marginalX[x];
+        }
+        double mean = 0, square = 0;
+        if (total <= 0) {
+            return { 0.0, 0.0 };
+        }
+        for (int x = 0; x < statesX; ++x) {
+            for (int c = 0; c < statesC; ++c) {
+                double joint = counts[x * statesC + c];
+                if (joint <= 0) {
                     continue;
                 }
-                auto key = std::make_pair(i, j);
-                auto value = conditionalMutualInformation(samples.index({ i, "..." }), samples.index({ j, "..." }), labels, weights);
-                scoresKPairs.push_back({ key, value });
+                double density = std::log(joint * total / (marginalX[x] * marginalC[c]));
+                mean += joint / total * density;
+                square += joint / total * density * density;
             }
         }
-        // sort scores
-        if (ascending) {
-            sort(scoresKPairs.begin(), scoresKPairs.end(), [](auto& a, auto& b)
-                { return a.second < b.second; });
-
-        } else {
-            sort(scoresKPairs.begin(), scoresKPairs.end(), [](auto& a, auto& b)
-                { return a.second > b.second; });
-        }
-        for (auto& [pairs, score] : scoresKPairs) {
-            pairsKBest.push_back(pairs);
-        }
-        if (k != 0 && k < pairsKBest.size()) {
-            if (ascending) {
-                int limit = pairsKBest.size() - k;
-                for (int i = 0; i < limit; i++) {
-                    pairsKBest.erase(pairsKBest.begin());
-                    scoresKPairs.erase(scoresKPairs.begin());
+        return { mean, square - mean * mean };
+    }
+    // Mean and variance of log p(y|x,c) - log p(x|c) over a table counts[c][x][y], the mean is H(X|C) - H(Y|X,C)
+    static std::pair<double, double> pairMoments(const std::vector<double>& counts, int statesC, int statesX, int statesY)
+    {
+        double total = std::accumulate(counts.begin(), counts.end(), 0.0);
+        double mean = 0, square = 0;
+        if (total <= 0) {
+            return { 0.0, 0.0 };
+        }
+        for (int c = 0; c < statesC; ++c) {
+            const double* rows = counts.data() + static_cast<size_t>(c) * statesX * statesY;
+            const double classCount = std::accumulate(rows, rows + statesX * statesY, 0.0);
+            for (int x = 0; x < statesX; ++x) {
+                const double* row = rows + x * statesY;
+                const double rowCount = std::accumulate(row, row + statesY, 0.0);
+                for (int y = 0; y < statesY; ++y) {
+                    if (row[y] <= 0) {
+                        continue;
+                    }
+                    double density = std::log(row[y] / rowCount) - std::log(rowCount / classCount);
+                    mean += row[y] / total * density;
+                    square += row[y] / total * density * density;
                 }
+            }
+        }
+        return { mean, square - mean * mean };
+    }
+    // Candidates whose confidence interval overlaps the cutoff: the selected ones that may be worse than some discarded
+    // one and the discarded ones that may be better than some selected one. Both orders select the k highest scores
+    static std::vector<int> overlappingCutoff(const std::vector<double>& scores, const std::vector<double>& halfWidths, bool ascending, unsigned k)
+    {
+        if (k == 0 || k >= scores.size()) {
+            return {};
+        }
+        std::vector<bool> selected(scores.size(), false);
+        for (int index : selectKBest(scores, ascending, k)) {
+            selected[index] = true;
+        }
+        double lowestSelected = std::numeric_limits<double>::max();
+        double highestDiscarded = std::numeric_limits<double>::lowest();
+        for (size_t i = 0; i < scores.size(); ++i) {
+            if (selected[i]) {
+                lowestSelected = std::min(lowestSelected, scores[i] - halfWidths[i]);
             } else {
-                pairsKBest.resize(k);
-                scoresKPairs.resize(k);
+                highestDiscarded = std::max(highestDiscarded, scores[i] + halfWidths[i]);
             }
         }
-        return pairsKBest;
+        std::vector<int> result;
+        for (size_t i = 0; i < scores.size(); ++i) {
+            if (selected[i] ? scores[i] - halfWidths[i] < highestDiscarded : scores[i] + halfWidths[i] > lowestSelected) {
+                result.push_back(i);
+            }
+        }
+        return result;
     }
-    std::vector<int> Metrics::SelectKBestWeighted(const torch::Tensor& weights, bool ascending, unsigned k)
+    std::vector<std::pair<int, int>> Metrics::SelectKPairs(const torch::Tensor& weights, std::vector<int>& featuresExcluded, bool ascending, unsigned k)
     {
         // Return the K Best features 
         auto n = features.size();
-        if (k == 0) {
-            k = n;
-        }
         // compute scores
-        scoresKBest.clear();
-        featuresKBest.clear();
-        auto label = samples.index({ -1, "..." });
+        scoresKPairs.clear();
+        pairsKBest.clear();
+        exactScored = 0;
+        std::vector<int> featureIds;
         for (int i = 0; i < n; ++i) {
-            scoresKBest.push_back(mutualInformation(label, samples.index({ i, "..." }), weights));
-            featuresKBest.push_back(i);
+            if (std::find(featuresExcluded.begin(), featuresExcluded.end(), i) == featuresExcluded.end()) {
+                featureIds.push_back(i);
+            }
         }
-        // sort & reduce scores and features
-        if (ascending) {
-            sort(featuresKBest.begin(), featuresKBest.end(), [&](int i, int j)
-                { return scoresKBest[i] < scoresKBest[j]; });
-            sort(scoresKBest.begin(), scoresKBest.end(), std::less<double>());
-            if (k < n) {
-                for (int i = 0; i < n - k; ++i) {
-                    featuresKBest.erase(featuresKBest.begin());
-                    scoresKBest.erase(scoresKBest.begin());
+        auto states = sampleStates();
+        const int classStates = states.back();
+        auto data = samples.to(torch::kInt32).contiguous();
+        auto weights_ = weights.to(torch::kFloat64).contiguous();
+        const int* labels = data.data_ptr<int>() + n * data.size(1);
+        // Pairs in lexicographic order, the pair (a, b) is stored after the pairs of the previous rows
+        const int nIds = featureIds.size();
+        std::vector<int> offsets(nIds, 0);
+        for (int a = 1; a < nIds; ++a) {
+            offsets[a] = offsets[a - 1] + nIds - a;
+        }
+        std::vector<std::pair<int, int>> pairs;
+        for (int a = 0; a < nIds; ++a) {
+            for (int b = a + 1; b < nIds; ++b) {
+                pairs.push_back({ featureIds[a], featureIds[b] });
+            }
+        }
+        std::vector<double> values(pairs.size());
+        if (approximate()) {
+            auto [sampleData, sampleWeights] = subsample(data, weights_);
+            std::vector<double> halfWidths(values.size());
+            pairwiseHistograms(sampleData, sampleWeights, featureIds, states, [&](int a, int b, const std::vector<double>& counts) {
+                auto [mean, variance] = pairMoments(counts, classStates, states[featureIds[a]], states[featureIds[b]]);
+                values[offsets[a] + b - a - 1] = std::max(mean, 0.0);
+                halfWidths[offsets[a] + b - a - 1] = halfWidth(variance, counts.size(), sampleData.size(1));
+                });
+            // Only the pairs near the cutoff are counted with all the samples
+            auto uncertain = overlappingCutoff(values, halfWidths, ascending, k);
+            ThreadPool::getInstance().parallel_for(0, uncertain.size(), 1, [&](int64_t begin, int64_t end) {
+                for (int64_t i = begin; i < end; ++i) {
+                    auto [first, second] = pairs[uncertain[i]];
+                    const int* x = data.data_ptr<int>() + first * data.size(1);
+                    const int* y = data.data_ptr<int>() + second * data.size(1);
+                    auto counts = ContingencyTable::count(labels, x, y, weights_.data_ptr<double>(), data.size(1), classStates, states[first], states[second]);
+                    auto classCounts = ContingencyTable::count(labels, x, weights_.data_ptr<double>(), data.size(1), classStates, states[first]);
+                    values[uncertain[i]] = std::max(ContingencyTable::conditionalEntropy(classCounts, states[first]) - ContingencyTable::conditionalEntropy(counts, states[second]), 0.0);
                 }
+                });
+            exactScored = uncertain.size();
+        } else if (statisticsCache) {
+            // The scores of all the pairs are shared with the selections of other classifiers
+            auto all = statisticsCache->get("H(Xi|C)-H(Xj|Xi,C)", weights_, [&]() {
+                std::vector<int> ids(n);
+                std::iota(ids.begin(), ids.end(), 0);
+                return torch::tensor(pairScores(data, weights_, states, ids), torch::kFloat64);
+                }).contiguous();
+            const double* allValues = all.data_ptr<double>();
+            for (size_t i = 0; i < pairs.size(); ++i) {
+                auto [first, second] = pairs[i];
+                values[i] = allValues[first * (2 * n - first - 1) / 2 + second - first - 1];
             }
         } else {
-            sort(featuresKBest.begin(), featuresKBest.end(), [&](int i, int j)
-                { return scoresKBest[i] > scoresKBest[j]; });
-            sort(scoresKBest.begin(), scoresKBest.end(), std::greater<double>());
-            featuresKBest.resize(k);
-            scoresKBest.resize(k);
+            values = pairScores(data, weights_, states, featureIds);
+        }
+        auto order = selectKBest(values, ascending, k);
+        for (int index : order) {
+            scoresKPairs.push_back({ pairs[index], values[index] });
+            pairsKBest.push_back(pairs[index]);
+        }
+        return pairsKBest;
+    }
+    // H(Xi|C) - H(Xj|Xi,C) of the pairs of featureIds in lexicographic order
+    std::vector<double> Metrics::pairScores(const torch::Tensor& data, const torch::Tensor& weights, const std::vector<int>& states, const std::vector<int>& featureIds) const
+    {
+        const int64_t n_samples = data.size(1);
+        const int* labels = data.data_ptr<int>() + (data.size(0) - 1) * n_samples;
+        const int classStates = states.back();
+        const int nIds = featureIds.size();
+        // H(Xi|C) of every feature
+        std::vector<double> classEntropy(nIds);
+        ThreadPool::getInstance().parallel_for(0, nIds, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t a = begin; a < end; ++a) {
+                int id = featureIds[a];
+                auto counts = ContingencyTable::count(labels, data.data_ptr<int>() + id * n_samples, weights.data_ptr<double>(), n_samples, classStates, states[id]);
+                classEntropy[a] = ContingencyTable::conditionalEntropy(counts, states[id]);
+            }
+            });
+        std::vector<int> offsets(nIds, 0);
+        for (int a = 1; a < nIds; ++a) {
+            offsets[a] = offsets[a - 1] + nIds - a;
+        }
+        std::vector<double> values(nIds < 2 ? 0 : offsets.back());
+        pairwiseHistograms(data, weights, featureIds, states, [&](int a, int b, const std::vector<double>& counts) {
+            // rows of the histogram are the combinations of class and first feature
+            values[offsets[a] + b - a - 1] = std::max(classEntropy[a] - ContingencyTable::conditionalEntropy(counts, states[featureIds[b]]), 0.0);
+            });
+        return values;
+    }
+    // I(C;Xi) = H(C) - H(C|Xi) of the features in ids, with the half width of its confidence interval if halfWidths is not null
+    std::vector<double> Metrics::featureScores(const torch::Tensor& data, const torch::Tensor& weights, const std::vector<int>& states, const std::vector<int>& ids, std::vector<double>* halfWidths) const
+    {
+        const int64_t n_samples = data.size(1);
+        const int* labels = data.data_ptr<int>() + (data.size(0) - 1) * n_samples;
+        const int classStates = states.back();
+        const double classEntropy = ContingencyTable::entropy(ContingencyTable::count(labels, weights.data_ptr<double>(), n_samples, classStates));
+        std::vector<double> scores(ids.size());
+        if (halfWidths != nullptr) {
+            halfWidths->resize(ids.size());
+        }
+        ThreadPool::getInstance().parallel_for(0, ids.size(), 1, [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; ++i) {
+                auto counts = ContingencyTable::count(data.data_ptr<int>() + ids[i] * n_samples, labels, weights.data_ptr<double>(), n_samples, states[ids[i]], classStates);
+                if (halfWidths == nullptr) {
+                    scores[i] = std::max(classEntropy - ContingencyTable::conditionalEntropy(counts, classStates), 0.0);
+                    continue;
+                }
+                auto [mean, variance] = mutualInformationMoments(counts, states[ids[i]], classStates);
+                scores[i] = std::max(mean, 0.0);
+                (*halfWidths)[i] = halfWidth(variance, counts.size(), n_samples);
+            }
+            });
+        return scores;
+    }
+    void Metrics::setStatisticsCache(std::shared_ptr<StatisticsCache> cache)
+    {
+        if (cache && !cache->matches(samples)) {
+            throw std::invalid_argument("The statistics cache does not hold the samples of the metrics");
+        }
+        statisticsCache = cache;
+    }
+    // I(C;Xi) of every feature, shared through the statistics cache if there is one
+    std::vector<double> Metrics::classMutualInformation(const torch::Tensor& weights)
+    {
+        auto weights_ = weights.to(torch::kFloat64).contiguous();
+        auto compute = [&]() {
+            auto data = samples.to(torch::kInt32).contiguous();
+            std::vector<int> ids(features.size());
+            std::iota(ids.begin(), ids.end(), 0);
+            return featureScores(data, weights_, sampleStates(), ids, nullptr);
+        };
+        if (!statisticsCache) {
+            return compute();
+        }
+        auto scores = statisticsCache->get("I(Xi;C)", weights_, [&]() { return torch::tensor(compute(), torch::kFloat64); }).contiguous();
+        return std::vector<double>(scores.data_ptr<double>(), scores.data_ptr<double>() + scores.numel());
+    }
+    std::vector<int> Metrics::SelectKBestWeighted(const torch::Tensor& weights, bool ascending, unsigned k)
+    {
+        // Return the K Best features 
+        auto n = features.size();
+        // compute scores, I(C;Xi) of every feature in parallel
+        std::vector<double> scores;
+        exactScored = 0;
+        if (approximate()) {
+            auto states = sampleStates();
+            auto data = samples.to(torch::kInt32).contiguous();
+            auto weights_ = weights.to(torch::kFloat64).contiguous();
+            std::vector<int> ids(n);
+            std::iota(ids.begin(), ids.end(), 0);
+            auto [sampleData, sampleWeights] = subsample(data, weights_);
+            std::vector<double> halfWidths;
+            scores = featureScores(sampleData, sampleWeights, states, ids, &halfWidths);
+            // Only the features near the cutoff are counted with all the samples
+            auto uncertain = overlappingCutoff(scores, halfWidths, ascending, k);
+            auto exact = featureScores(data, weights_, states, uncertain, nullptr);
+            for (size_t i = 0; i < uncertain.size(); ++i) {
+                scores[uncertain[i]] = exact[i];
+            }
+            exactScored = uncertain.size();
+        } else {
+            scores = classMutualInformation(weights);
+        }
+        // sort & reduce scores and features
+        featuresKBest = selectKBest(scores, ascending, k);
+        scoresKBest.clear();
+        for (int feature : featuresKBest) {
+            scoresKBest.push_back(scores[feature]);
         }
         return featuresKBest;
     }
@@ -120,122 +386,166 @@ namespace bayesnet {
     {
         return scoresKPairs;
     }
+    std::vector<int> Metrics::sampleStates() const
+    {
+        if (samples.size(1) == 0) {
+            return std::vector<int>(samples.size(0), 0);
+        }
+        auto data = samples.to(torch::kInt32);
+        if (data.min().item<int>() < 0) {
+            throw std::invalid_argument("Discrete variables can not have negative values");
+        }
+        auto maxValues = data.amax(1).contiguous();
+        std::vector<int> states(maxValues.data_ptr<int>(), maxValues.data_ptr<int>() + maxValues.numel());
+        for (auto& value : states) {
+            ++value;
+        }
+        return states;
+    }
+    // The histograms of all the pairs of one feature are accumulated together, sample block by sample block,
+    // so the rows of the feature and the class are read from cache while every pair is updated by the ContingencyTable kernel
+    void Metrics::pairwiseHistograms(const torch::Tensor& data, const torch::Tensor& weights, const std::vector<int>& featureIds, const std::vector<int>& states, const std::function<void(int, int, const std::vector<double>&)>& visit) const
+    {
+        const int64_t n_samples = data.size(1);
+        const int* values = data.data_ptr<int>();
+        const int* labels = values + (data.size(0) - 1) * n_samples;
+        const double* weights_ptr = weights.data_ptr<double>();
+        const int classStates = states.back();
+        const int nIds = featureIds.size();
+        const int64_t block = 1024;
+        ThreadPool::getInstance().parallel_for(0, nIds - 1, 1, [&](int64_t first, int64_t last) {
+            for (int a = first; a < last; ++a) {
+                const int* x = values + featureIds[a] * n_samples;
+                const int statesX = states[featureIds[a]];
+                std::vector<std::vector<double>> histograms;
+                for (int b = a + 1; b < nIds; ++b) {
+                    histograms.emplace_back(static_cast<size_t>(classStates) * statesX * states[featureIds[b]], 0.0);
+                }
+                for (int64_t begin = 0; begin < n_samples; begin += block) {
+                    int64_t end = std::min(begin + block, n_samples);
+                    for (int b = a + 1; b < nIds; ++b) {
+                        const int* y = values + featureIds[b] * n_samples;
+                        auto& counts = histograms[b - a - 1];
+                        ContingencyTable::accumulate(labels + begin, x + begin, y + begin, weights_ptr + begin, end - begin, statesX, states[featureIds[b]], counts.data(), counts.size());
+                    }
+                }
+                for (int b = a + 1; b < nIds; ++b) {
+                    visit(a, b, histograms[b - a - 1]);
+                }
+            }
+            });
+    }
+    // I(Xi;Xj|C) matrix of the features and the class, the pairs with the class are 0
+    // In approximate mode the histograms are taken from the subsample, there is no cutoff to refine
     torch::Tensor Metrics::conditionalEdge(const torch::Tensor& weights)
     {
-        auto result = std::vector<double>();
-        auto source = std::vector<std::string>(features);
-        source.push_back(className);
-        auto combinations = doCombinations(source);
+        const long n_vars = features.size() + 1;
+        conditionalEdgeHalfWidths = torch::zeros({ n_vars, n_vars });
+        if (samples.size(1) == 0) {
+            return torch::zeros({ n_vars, n_vars });
+        }
+        auto states = sampleStates();
         // Compute class prior
-        auto margin = torch::zeros({ classNumStates }, torch::kFloat);
+        auto labels = samples.index({ -1, "..." });
+        std::vector<double> margin(classNumStates, 0.0);
         for (int value = 0; value < classNumStates; ++value) {
-            auto mask = samples.index({ -1,  "..." }) == value;
-            margin[value] = mask.sum().item<double>() / samples.size(1);
+            margin[value] = (labels == value).sum().item<double>() / samples.size(1);
         }
-        for (auto [first, second] : combinations) {
-            int index_first = find(features.begin(), features.end(), first) - features.begin();
-            int index_second = find(features.begin(), features.end(), second) - features.begin();
-            double accumulated = 0;
-            for (int value = 0; value < classNumStates; ++value) {
-                auto mask = samples.index({ -1, "..." }) == value;
-                auto first_dataset = samples.index({ index_first, mask });
-                auto second_dataset = samples.index({ index_second, mask });
-                auto weights_dataset = weights.index({ mask });
-                auto mi = mutualInformation(first_dataset, second_dataset, weights_dataset);
-                auto pb = margin[value].item<double>();
-                accumulated += pb * mi;
-            }
-            result.push_back(accumulated);
+        auto data = samples.to(torch::kInt32).contiguous();
+        auto weights_ = weights.to(torch::kFloat64).contiguous();
+        if (approximate()) {
+            std::tie(data, weights_) = subsample(data, weights_);
+            return conditionalEdgeMatrix(data, weights_, states, margin, &conditionalEdgeHalfWidths);
+        } else if (statisticsCache) {
+            return statisticsCache->get("I(Xi;Xj|C)", weights_, [&]() { return conditionalEdgeMatrix(data, weights_, states, margin); }).clone();
         }
-        long n_vars = source.size();
+        return conditionalEdgeMatrix(data, weights_, states, margin);
+    }
+    // Sum of I(Xi;Xj|C=c) weighted by the class margin, if halfWidths is not null every term adds the half width of the
+    // interval of its estimate computed with the samples of the class
+    torch::Tensor Metrics::conditionalEdgeMatrix(const torch::Tensor& data, const torch::Tensor& weights, const std::vector<int>& states, const std::vector<double>& margin, torch::Tensor* halfWidths) const
+    {
+        const long n_vars = features.size() + 1;
         auto matrix = torch::zeros({ n_vars, n_vars });
-        auto indices = torch::triu_indices(n_vars, n_vars, 1);
-        for (auto i = 0; i < result.size(); ++i) {
-            auto x = indices[0][i];
-            auto y = indices[1][i];
-            matrix[x][y] = result[i];
-            matrix[y][x] = result[i];
+        const int classStates = states.back();
+        std::vector<int> featureIds(features.size());
+        std::iota(featureIds.begin(), featureIds.end(), 0);
+        float* result = matrix.data_ptr<float>();
+        float* widths = nullptr;
+        std::vector<int64_t> classSizes(classStates, 0);
+        if (halfWidths != nullptr) {
+            *halfWidths = torch::zeros({ n_vars, n_vars });
+            widths = halfWidths->data_ptr<float>();
+            const int* labels = data.data_ptr<int>() + (data.size(0) - 1) * data.size(1);
+            for (int64_t sample = 0; sample < data.size(1); ++sample) {
+                ++classSizes[labels[sample]];
+            }
         }
+        pairwiseHistograms(data, weights, featureIds, states, [&](int a, int b, const std::vector<double>& counts) {
+            const int statesX = states[a];
+            const int statesY = states[b];
+            double accumulated = 0;
+            double width = 0;
+            for (int value = 0; value < std::min(classNumStates, classStates); ++value) {
+                const double* table = counts.data() + value * statesX * statesY;
+                auto mi = std::max(ContingencyTable::mutualInformation(table, statesX, statesY), 0.0);
+                accumulated += margin[value] * mi;
+                if (widths != nullptr && classSizes[value] > 0) {
+                    auto [mean, variance] = mutualInformationMoments(std::vector<double>(table, table + statesX * statesY), statesX, statesY);
+                    width += margin[value] * halfWidth(variance, statesX * statesY, classSizes[value]);
+                }
+            }
+            result[a * n_vars + b] = accumulated;
+            result[b * n_vars + a] = accumulated;
+            if (widths != nullptr) {
+                widths[a * n_vars + b] = width;
+                widths[b * n_vars + a] = width;
+            }
+            });
         return matrix;
     }
+    // Contiguous int copy of a discrete variable and its number of states (maximum value + 1)
+    static std::pair<torch::Tensor, int> discreteVariable(const torch::Tensor& feature)
+    {
+        auto values = feature.to(torch::kInt32).contiguous();
+        if (values.numel() == 0) {
+            return { values, 0 };
+        }
+        if (values.min().item<int>() < 0) {
+            throw std::invalid_argument("Discrete variables can not have negative values");
+        }
+        return { values, values.max().item<int>() + 1 };
+    }
     // Measured in nats (natural logarithm (log) base e)
     // Elements of Information Theory, 2nd Edition, Thomas M. Cover, Joy A. Thomas p. 14
     double Metrics::entropy(const torch::Tensor& feature, const torch::Tensor& weights)
     {
-        torch::Tensor counts = feature.bincount(weights);
-        double totalWeight = counts.sum().item<double>();
-        torch::Tensor probs = counts.to(torch::kFloat) / totalWeight;
-        torch::Tensor logProbs = torch::log(probs);
-        torch::Tensor entropy = -probs * logProbs;
-        return entropy.nansum().item<double>();
+        auto [values, states] = discreteVariable(feature);
+        auto weights_ = weights.to(torch::kFloat64).contiguous();
+        auto counts = ContingencyTable::count(values.data_ptr<int>(), weights_.data_ptr<double>(), values.numel(), states);
+        return ContingencyTable::entropy(counts);
     }
     // H(Y|X) = sum_{x in X} p(x) H(Y|X=x)
     double Metrics::conditionalEntropy(const torch::Tensor& firstFeature, const torch::Tensor& secondFeature, const torch::Tensor& weights)
     {
-        int numSamples = firstFeature.sizes()[0];
-        torch::Tensor featureCounts = secondFeature.bincount(weights);
-        std::unordered_map<int, std::unordered_map<int, double>> jointCounts;
-        double totalWeight = 0;
-        for (auto i = 0; i < numSamples; i++) {
-            jointCounts[secondFeature[i].item<int>()][firstFeature[i].item<int>()] += weights[i].item<double>();
-            totalWeight += weights[i].item<float>();
-        }
-        if (totalWeight == 0)
-            return 0;
-        double entropyValue = 0;
-        for (int value = 0; value < featureCounts.sizes()[0]; ++value) {
-            double p_f = featureCounts[value].item<double>() / totalWeight;
-            double entropy_f = 0;
-            for (auto& [label, jointCount] : jointCounts[value]) {
-                double p_l_f = jointCount / featureCounts[value].item<double>();
-                if (p_l_f > 0) {
-                    entropy_f -= p_l_f * log(p_l_f);
-                } else {
-                    entropy_f = 0;
-                }
-            }
-            entropyValue += p_f * entropy_f;
-        }
-        return entropyValue;
+        auto [first, firstStates] = discreteVariable(firstFeature);
+        auto [second, secondStates] = discreteVariable(secondFeature);
+        auto weights_ = weights.to(torch::kFloat64).contiguous();
+        auto counts = ContingencyTable::count(second.data_ptr<int>(), first.data_ptr<int>(), weights_.data_ptr<double>(), first.numel(), secondStates, firstStates);
+        return ContingencyTable::conditionalEntropy(counts, firstStates);
     }
     // H(X|Y,C) = sum_{y in Y, c in C} p(x,c) H(X|Y=y,C=c)
     double Metrics::conditionalEntropy(const torch::Tensor& firstFeature, const torch::Tensor& secondFeature, const torch::Tensor& labels, const torch::Tensor& weights)
     {
         // Ensure the tensors are of the same length
         assert(firstFeature.size(0) == secondFeature.size(0) && firstFeature.size(0) == labels.size(0) && firstFeature.size(0) == weights.size(0));
-        // Convert tensors to vectors for easier processing
-        auto firstFeatureData = firstFeature.accessor<int, 1>();
-        auto secondFeatureData = secondFeature.accessor<int, 1>();
-        auto labelsData = labels.accessor<int, 1>();
-        auto weightsData = weights.accessor<double, 1>();
-        int numSamples = firstFeature.size(0);
-        // Maps for joint and marginal probabilities
-        std::map<std::tuple<int, int, int>, double> jointCount;
-        std::map<std::tuple<int, int>, double> marginalCount;
-        // Compute joint and marginal counts
-        for (int i = 0; i < numSamples; ++i) {
-            auto keyJoint = std::make_tuple(firstFeatureData[i], labelsData[i], secondFeatureData[i]);
-            auto keyMarginal = std::make_tuple(firstFeatureData[i], labelsData[i]);
-
-            jointCount[keyJoint] += weightsData[i];
-            marginalCount[keyMarginal] += weightsData[i];
-        }
-        // Total weight sum
-        double totalWeight = torch::sum(weights).item<double>();
-        if (totalWeight == 0)
-            return 0;
-        // Compute the conditional entropy
-        double conditionalEntropy = 0.0;
-        for (const auto& [keyJoint, jointFreq] : jointCount) {
-            auto [x, c, y] = keyJoint;
-            auto keyMarginal = std::make_tuple(x, c);
-            //double p_xc = marginalCount[keyMarginal] / totalWeight;
-            double p_y_given_xc = jointFreq / marginalCount[keyMarginal];
-            if (p_y_given_xc > 0) {
-                conditionalEntropy -= (jointFreq / totalWeight) * std::log(p_y_given_xc);
-            }
-        }
-        return conditionalEntropy;
+        auto [first, firstStates] = discreteVariable(firstFeature);
+        auto [second, secondStates] = discreteVariable(secondFeature);
+        auto [classes, classStates] = discreteVariable(labels);
+        auto weights_ = weights.to(torch::kFloat64).contiguous();
+        // The second feature is conditioned on the first one and the class
+        auto counts = ContingencyTable::count(first.data_ptr<int>(), classes.data_ptr<int>(), second.data_ptr<int>(), weights_.data_ptr<double>(), first.numel(), firstStates, classStates, secondStates);
+        return ContingencyTable::conditionalEntropy(counts, secondStates);
     }
     // I(X;Y) = H(Y) - H(Y|X) ; I(X;Y) >= 0
     double Metrics::mutualInformation(const torch::Tensor& firstFeature, const torch::Tensor& secondFeature, const torch::Tensor& weights)
@@ -6,9 +6,12 @@
 
 #ifndef BAYESNET_METRICS_H
 #define BAYESNET_METRICS_H
+#include <functional>
+#include <memory>
 #include <vector>
 #include <string>
 #include <torch/torch.h>
+#include "StatisticsCache.h"
 namespace bayesnet {
     class Metrics {
     public:
@@ -17,6 +20,19 @@ namespace bayesnet {
         Metrics(const std::vector<std::vector<int>>& vsamples, const std::vector<int>& labels, const std::vector<std::string>& features, const std::string& className, const int classNumStates);
         std::vector<int> SelectKBestWeighted(const torch::Tensor& weights, bool ascending = false, unsigned k = 0);
         std::vector<std::pair<int, int>> SelectKPairs(const torch::Tensor& weights, std::vector<int>& featuresExcluded, bool ascending = false, unsigned k = 0);
+        // Opt-in approximate scoring for very large datasets, the sample size bounds the time and the confidence the
+        // accuracy. With more samples than sampleSize the scores are estimated on a class stratified weighted subsample
+        // of about sampleSize samples and only the candidates whose confidence interval overlaps the selection cutoff
+        // are scored again with all the samples. conditionalEdge returns the estimates. sampleSize 0 (default) is exact
+        void setApproximation(int64_t sampleSize, double confidence = 0.95);
+        int getExactScored() const { return exactScored; } // candidates scored with all the samples in the last selection
+        // Half widths of the confidence intervals of the last conditionalEdge matrix, zeros if it was exact
+        torch::Tensor getConditionalEdgeHalfWidths() const { return conditionalEdgeHalfWidths; }
+        // The exact scores of the features and pairs and the conditionalEdge matrix are taken from cache (or computed
+        // and stored in it), cache must be built with the samples of this object
+        void setStatisticsCache(std::shared_ptr<StatisticsCache> cache);
+        std::shared_ptr<StatisticsCache> getStatisticsCache() const { return statisticsCache; }
+        std::vector<double> classMutualInformation(const torch::Tensor& weights); // I(Xi;C) of every feature
         std::vector<double> getScoresKBest() const;
         std::vector<std::pair<std::pair<int, int>, double>> getScoresKPairs() const;
         double mutualInformation(const torch::Tensor& firstFeature, const torch::Tensor& secondFeature, const torch::Tensor& weights);
@@ -56,7 +72,23 @@ namespace bayesnet {
         std::vector<int> featuresKBest; // sorted indices of the features
         std::vector<std::pair<int, int>> pairsKBest; // sorted indices of the pairs
         std::vector<std::pair<std::pair<int, int>, double>> scoresKPairs;
+        int64_t approximationSize = 0;
+        double quantile = 1.959963984540054; // normal quantile of the approximation confidence
+        int exactScored = 0;
+        torch::Tensor conditionalEdgeHalfWidths;
+        std::shared_ptr<StatisticsCache> statisticsCache;
         double conditionalEntropy(const torch::Tensor& firstFeature, const torch::Tensor& secondFeature, const torch::Tensor& weights);
+        bool approximate() const;
+        // data is an int n+1xm copy of samples and weights a double vector, both contiguous
+        std::pair<torch::Tensor, torch::Tensor> subsample(const torch::Tensor& data, const torch::Tensor& weights) const;
+        double halfWidth(double variance, int64_t cells, int64_t n) const;
+        std::vector<double> featureScores(const torch::Tensor& data, const torch::Tensor& weights, const std::vector<int>& states, const std::vector<int>& ids, std::vector<double>* halfWidths) const;
+        std::vector<double> pairScores(const torch::Tensor& data, const torch::Tensor& weights, const std::vector<int>& states, const std::vector<int>& featureIds) const;
+        torch::Tensor conditionalEdgeMatrix(const torch::Tensor& data, const torch::Tensor& weights, const std::vector<int>& states, const std::vector<double>& margin, torch::Tensor* halfWidths = nullptr) const;
+        std::vector<int> sampleStates() const; // number of states of every row of samples, maximum value + 1
+        // Calls visit(a, b, counts) from the pool workers for every pair a < b of positions in featureIds, where
+        // counts[c][xi][xj] is the weighted histogram of the class and the features featureIds[a] and featureIds[b]
+        void pairwiseHistograms(const torch::Tensor& data, const torch::Tensor& weights, const std::vector<int>& featureIds, const std::vector<int>& states, const std::function<void(int, int, const std::vector<double>&)>& visit) const;
     };
 }
 #endif
\ No newline at end of file
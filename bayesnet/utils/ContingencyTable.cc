@@ -0,0 +1,240 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BAYESNET_X86
+#endif
+#include "ContingencyTable.h"
+namespace bayesnet {
+    /*
+    Weighted histograms.
+    The vector kernels compute the cell index of several samples at once and keep a private copy of the table
+    for every lane, interleaved as private[cell * lanes + lane], so consecutive samples that fall in the same
+    cell never update the same counter and AVX-512 can gather and scatter a whole vector without conflicts.
+    The copies are added at the end, so they are only used when the table is small compared with the samples.
+    */
+    namespace {
+        constexpr int lanes = 8;
+        constexpr int64_t maxPrivateCells = 4096;
+        template<int Dims>
+        inline int64_t cellIndex(const int* x, const int* y, const int* z, int64_t i, int statesY, int statesZ)
+        {
+            int64_t index = x[i];
+            if constexpr (Dims > 1) {
+                index = index * statesY + y[i];
+            }
+            if constexpr (Dims > 2) {
+                index = index * statesZ + z[i];
+            }
+            return index;
+        }
+        template<int Dims>
+        void accumulateScalar(const int* x, const int* y, const int* z, const double* weights, int64_t n, int statesY, int statesZ, double* counts)
+        {
+            for (int64_t i = 0; i < n; ++i) {
+                counts[cellIndex<Dims>(x, y, z, i, statesY, statesZ)] += weights[i];
+            }
+        }
+#ifdef BAYESNET_X86
+        template<int Dims>
+        __attribute__((target("avx2"))) inline __m256i cellIndexAvx2(const int* x, const int* y, const int* z, int64_t i, __m256i vStatesY, __m256i vStatesZ)
+        {
+            __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+            if constexpr (Dims > 1) {
+                index = _mm256_add_epi32(_mm256_mullo_epi32(index, vStatesY), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i)));
+            }
+            if constexpr (Dims > 2) {
+                index = _mm256_add_epi32(_mm256_mullo_epi32(index, vStatesZ), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(z + i)));
+            }
+            // private counter of every lane
+            return _mm256_add_epi32(_mm256_slli_epi32(index, 3), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        }
+        template<int Dims>
+        __attribute__((target("avx2"))) void accumulateAvx2(const int* x, const int* y, const int* z, const double* weights, int64_t n, int statesY, int statesZ, double* counts)
+        {
+            const __m256i vStatesY = _mm256_set1_epi32(statesY);
+            const __m256i vStatesZ = _mm256_set1_epi32(statesZ);
+            alignas(32) int cells[lanes];
+            int64_t i = 0;
+            for (; i + lanes <= n; i += lanes) {
+                _mm256_store_si256(reinterpret_cast<__m256i*>(cells), cellIndexAvx2<Dims>(x, y, z, i, vStatesY, vStatesZ));
+                for (int lane = 0; lane < lanes; ++lane) {
+                    counts[cells[lane]] += weights[i + lane];
+                }
+            }
+            for (; i < n; ++i) {
+                counts[cellIndex<Dims>(x, y, z, i, statesY, statesZ) * lanes] += weights[i];
+            }
+        }
+        template<int Dims>
+        __attribute__((target("avx2,avx512f"))) void accumulateAvx512(const int* x, const int* y, const int* z, const double* weights, int64_t n, int statesY, int statesZ, double* counts)
+        {
+            const __m256i vStatesY = _mm256_set1_epi32(statesY);
+            const __m256i vStatesZ = _mm256_set1_epi32(statesZ);
+            int64_t i = 0;
+            for (; i + lanes <= n; i += lanes) {
+                __m256i cells = cellIndexAvx2<Dims>(x, y, z, i, vStatesY, vStatesZ);
+                // masked gather with a zeroed source, the unmasked one leaves its source undefined for gcc (-Wmaybe-uninitialized)
+                __m512d counters = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, cells, counts, 8);
+                __m512d values = _mm512_add_pd(counters, _mm512_loadu_pd(weights + i));
+                _mm512_i32scatter_pd(counts, cells, values, 8);
+            }
+            for (; i < n; ++i) {
+                counts[cellIndex<Dims>(x, y, z, i, statesY, statesZ) * lanes] += weights[i];
+            }
+        }
+#endif
+        ContingencyTable::Kernel detectKernel()
+        {
+#ifdef BAYESNET_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f")) {
+                return ContingencyTable::Kernel::AVX512;
+            }
+            if (__builtin_cpu_supports("avx2")) {
+                return ContingencyTable::Kernel::AVX2;
+            }
+#endif
+            return ContingencyTable::Kernel::SCALAR;
+        }
+        std::atomic<ContingencyTable::Kernel>& currentKernel()
+        {
+            static std::atomic<ContingencyTable::Kernel> kernel{ detectKernel() };
+            return kernel;
+        }
+        template<int Dims>
+        void accumulateDims(const int* x, const int* y, const int* z, const double* weights, int64_t n, int statesY, int statesZ, double* counts, int64_t size)
+        {
+            auto kernel = currentKernel().load();
+            if (kernel == ContingencyTable::Kernel::SCALAR || size > maxPrivateCells || n < size * lanes) {
+                accumulateScalar<Dims>(x, y, z, weights, n, statesY, statesZ, counts);
+                return;
+            }
+#ifdef BAYESNET_X86
+            // Scratch of the thread reused between calls, Network::accumulateCounts and Metrics::pairwiseHistograms call this for every block
+            thread_local std::vector<double> privateCounts;
+            privateCounts.assign(size * lanes, 0.0);
+            if (kernel == ContingencyTable::Kernel::AVX512) {
+                accumulateAvx512<Dims>(x, y, z, weights, n, statesY, statesZ, privateCounts.data());
+            } else {
+                accumulateAvx2<Dims>(x, y, z, weights, n, statesY, statesZ, privateCounts.data());
+            }
+            for (int64_t cell = 0; cell < size; ++cell) {
+                const double* copies = privateCounts.data() + cell * lanes;
+                counts[cell] += ((copies[0] + copies[1]) + (copies[2] + copies[3])) + ((copies[4] + copies[5]) + (copies[6] + copies[7]));
+            }
+#endif
+        }
+    }
+    ContingencyTable::Kernel ContingencyTable::getKernel()
+    {
+        return currentKernel().load();
+    }
+    bool ContingencyTable::isSupported(Kernel kernel)
+    {
+        auto best = detectKernel();
+        return kernel == Kernel::SCALAR || kernel == best || (kernel == Kernel::AVX2 && best == Kernel::AVX512);
+    }
+    void ContingencyTable::setKernel(Kernel kernel)
+    {
+        if (!isSupported(kernel)) {
+            throw std::invalid_argument("The histogram kernel is not supported by this cpu");
+        }
+        currentKernel().store(kernel);
+    }
+    void ContingencyTable::accumulate(const int* x, const int* y, const int* z, const double* weights, int64_t n, int statesY, int statesZ, double* counts, int64_t size)
+    {
+        if (z != nullptr) {
+            accumulateDims<3>(x, y, z, weights, n, statesY, statesZ, counts, size);
+        } else if (y != nullptr) {
+            accumulateDims<2>(x, y, z, weights, n, statesY, statesZ, counts, size);
+        } else {
+            accumulateDims<1>(x, y, z, weights, n, statesY, statesZ, counts, size);
+        }
+    }
+    std::vector<double> ContingencyTable::count(const int* x, const double* weights, int64_t n, int statesX)
+    {
+        std::vector<double> counts(statesX, 0.0);
+        accumulate(x, nullptr, nullptr, weights, n, 1, 1, counts.data(), counts.size());
+        return counts;
+    }
+    std::vector<double> ContingencyTable::count(const int* x, const int* y, const double* weights, int64_t n, int statesX, int statesY)
+    {
+        std::vector<double> counts(static_cast<size_t>(statesX) * statesY, 0.0);
+        accumulate(x, y, nullptr, weights, n, statesY, 1, counts.data(), counts.size());
+        return counts;
+    }
+    std::vector<double> ContingencyTable::count(const int* x, const int* y, const int* z, const double* weights, int64_t n, int statesX, int statesY, int statesZ)
+    {
+        std::vector<double> counts(static_cast<size_t>(statesX) * statesY * statesZ, 0.0);
+        accumulate(x, y, z, weights, n, statesY, statesZ, counts.data(), counts.size());
+        return counts;
+    }
+    double ContingencyTable::entropy(const std::vector<double>& counts)
+    {
+        return conditionalEntropy(counts, static_cast<int>(counts.size()));
+    }
+    // H(Y|X) = - sum_{x,y} p(x,y) log(p(x,y) / p(x))
+    double ContingencyTable::conditionalEntropy(const std::vector<double>& counts, int statesY)
+    {
+        double totalWeight = 0;
+        double result = 0;
+        for (size_t row = 0; row + statesY <= counts.size(); row += statesY) {
+            const double* cells = counts.data() + row;
+            double rowWeight = 0;
+            for (int y = 0; y < statesY; ++y) {
+                rowWeight += cells[y];
+            }
+            totalWeight += rowWeight;
+            if (rowWeight <= 0) {
+                continue;
+            }
+            for (int y = 0; y < statesY; ++y) {
+                if (cells[y] > 0) {
+                    result -= cells[y] * std::log(cells[y] / rowWeight);
+                }
+            }
+        }
+        if (totalWeight <= 0) {
+            return 0;
+        }
+        return result / totalWeight;
+    }
+    double ContingencyTable::mutualInformation(const double* counts, int statesX, int statesY)
+    {
+        std::vector<double> rowWeights(statesX, 0.0);
+        std::vector<double> columnWeights(statesY, 0.0);
+        double totalWeight = 0;
+        for (int x = 0; x < statesX; ++x) {
+            for (int y = 0; y < statesY; ++y) {
+                rowWeights[x] += counts[x * statesY + y];
+                columnWeights[y] += counts[x * statesY + y];
+            }
+            totalWeight += rowWeights[x];
+        }
+        if (totalWeight <= 0) {
+            return 0;
+        }
+        double entropyX = 0;
+        double conditionalEntropyXY = 0;
+        for (int x = 0; x < statesX; ++x) {
+            if (rowWeights[x] > 0) {
+                entropyX -= rowWeights[x] * std::log(rowWeights[x] / totalWeight);
+            }
+            for (int y = 0; y < statesY; ++y) {
+                double cell = counts[x * statesY + y];
+                if (cell > 0) {
+                    conditionalEntropyXY -= cell * std::log(cell / columnWeights[y]);
+                }
+            }
+        }
+        return (entropyX - conditionalEntropyXY) / totalWeight;
+    }
+}
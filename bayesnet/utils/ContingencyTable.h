@@ -0,0 +1,41 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#ifndef CONTINGENCY_TABLE_H
+#define CONTINGENCY_TABLE_H
+#include <cstdint>
+#include <vector>
+namespace bayesnet {
+    /*
+    Dense weighted contingency tables of discrete variables.
+    The tables are flat arrays in row major order with the last variable varying fastest,
+    the values of every variable must be in [0, states).
+    */
+    class ContingencyTable {
+    public:
+        // Histogram kernels, the best one supported by the cpu is chosen at runtime
+        enum class Kernel { SCALAR, AVX2, AVX512 };
+        static Kernel getKernel();
+        static bool isSupported(Kernel kernel);
+        static void setKernel(Kernel kernel); // throws std::invalid_argument if the cpu does not support it
+        // counts[(x * statesY + y) * statesZ + z] += weights[i] for the n samples, y and z are nullptr in 1-D and 2-D tables.
+        // counts must hold all the cells of the table and keeps its previous contents
+        static void accumulate(const int* x, const int* y, const int* z, const double* weights, int64_t n, int statesY, int statesZ, double* counts, int64_t size);
+        // counts[x] += weights[i] for x = values[i]
+        static std::vector<double> count(const int* x, const double* weights, int64_t n, int statesX);
+        // counts[x][y]
+        static std::vector<double> count(const int* x, const int* y, const double* weights, int64_t n, int statesX, int statesY);
+        // counts[x][y][z]
+        static std::vector<double> count(const int* x, const int* y, const int* z, const double* weights, int64_t n, int statesX, int statesY, int statesZ);
+        // H(X) in nats of the counts of one variable
+        static double entropy(const std::vector<double>& counts);
+        // H(Y|X) in nats of the counts[x][y] of a table with statesY columns, X can be the flattened combination of several variables
+        static double conditionalEntropy(const std::vector<double>& counts, int statesY);
+        // I(X;Y) = H(X) - H(X|Y) in nats of the counts[x][y] of a statesX x statesY table
+        static double mutualInformation(const double* counts, int statesX, int statesY);
+    };
+}
+#endif
@@ -4,53 +4,21 @@
 // SPDX-License-Identifier: MIT
 // ***************************************************************
 
-#include <sstream>
+#include <algorithm>
 #include <vector>
 #include <list>
 #include "Mst.h"
-/*
-    Based on the code from https://www.softwaretestinghelp.com/minimum-spanning-tree-tutorial/
-
-*/
 
 namespace bayesnet {
-    Graph::Graph(int V) : V(V), parent(std::vector<int>(V))
-    {
-        for (int i = 0; i < V; i++)
-            parent[i] = i;
-        G.clear();
-        T.clear();
-    }
-    void Graph::addEdge(int u, int v, float wt)
+    // Total order of the edges (weight, (i, j)) with i < j: higher weight first and ties by (i, j), the order of a
+    // stable sort by decreasing weight of the edges generated in lexicographic order. With a total order the maximum
+    // spanning tree is unique, so every algorithm finds the same tree
+    static bool heavier(float weight, const std::pair<int, int>& edge, float otherWeight, const std::pair<int, int>& otherEdge)
     {
-        G.push_back({ wt, { u, v } });
-    }
-    int Graph::find_set(int i)
-    {
-        // If i is the parent of itself
-        if (i == parent[i])
-            return i;
-        else
-            //else recursively find the parent of i
-            return find_set(parent[i]);
-    }
-    void Graph::union_set(int u, int v)
-    {
-        parent[u] = parent[v];
-    }
-    void Graph::kruskal_algorithm()
-    {
-        // sort the edges ordered on decreasing weight
-        stable_sort(G.begin(), G.end(), [](const auto& left, const auto& right) {return left.first > right.first;});
-        for (int i = 0; i < G.size(); i++) {
-            int uSt, vEd;
-            uSt = find_set(G[i].second.first);
-            vEd = find_set(G[i].second.second);
-            if (uSt != vEd) {
-                T.push_back(G[i]); // add to mst std::vector
-                union_set(uSt, vEd);
-            }
+        if (weight != otherWeight) {
+            return weight > otherWeight;
         }
+        return edge < otherEdge;
     }
 
     void MST::insertElement(std::list<int>& variables, int variable)
@@ -63,58 +31,99 @@ namespace bayesnet {
     std::vector<std::pair<int, int>> MST::reorder(std::vector<std::pair<float, std::pair<int, int>>> T, int root_original)
     {
         // Create the edges of a DAG from the MST
-        // replacing unordered_set with list because unordered_set cannot guarantee the order of the elements inserted
+        // Every variable visits its pending edges in the order of T, the variables reached are visited last in first out
         auto result = std::vector<std::pair<int, int>>();
-        auto visited = std::vector<int>();
-        auto nextVariables = std::list<int>();
-        nextVariables.push_front(root_original);
-        while (nextVariables.size() > 0) {
-            int root = nextVariables.front();
-            nextVariables.pop_front();
-            for (int i = 0; i < T.size(); ++i) {
-                auto [weight, edge] = T[i];
-                auto [from, to] = edge;
-                if (from == root || to == root) {
-                    visited.insert(visited.begin(), i);
-                    if (from == root) {
-                        result.push_back({ from, to });
-                        insertElement(nextVariables, to);
-                    } else {
-                        result.push_back({ to, from });
-                        insertElement(nextVariables, from);
-                    }
-                }
+        int nodes = root_original + 1;
+        for (const auto& [weight, edge] : T) {
+            nodes = std::max({ nodes, edge.first + 1, edge.second + 1 });
+        }
+        std::vector<std::vector<int>> incident(nodes);
+        for (int i = 0; i < T.size(); ++i) {
+            auto [from, to] = T[i].second;
+            incident[from].push_back(i);
+            if (to != from) {
+                incident[to].push_back(i);
             }
-            // Remove visited
-            for (int i = 0; i < visited.size(); ++i) {
-                T.erase(T.begin() + visited[i]);
+        }
+        std::vector<bool> used(T.size(), false);
+        std::vector<bool> pending(nodes, false);
+        auto nextVariables = std::vector<int>{ root_original };
+        pending[root_original] = true;
+        while (!nextVariables.empty()) {
+            int root = nextVariables.back();
+            nextVariables.pop_back();
+            pending[root] = false;
+            for (int i : incident[root]) {
+                if (used[i]) {
+                    continue;
+                }
+                used[i] = true;
+                auto [from, to] = T[i].second;
+                int next = from == root ? to : from;
+                result.push_back({ root, next });
+                if (!pending[next]) {
+                    pending[next] = true;
+                    nextVariables.push_back(next);
+                }
             }
-            visited.clear();
         }
-        if (T.size() > 0) {
-            for (int i = 0; i < T.size(); ++i) {
-                auto [weight, edge] = T[i];
-                auto [from, to] = edge;
-                result.push_back({ from, to });
+        // Edges not connected to the root
+        for (int i = 0; i < T.size(); ++i) {
+            if (!used[i]) {
+                result.push_back(T[i].second);
             }
         }
         return result;
     }
 
     MST::MST(const std::vector<std::string>& features, const torch::Tensor& weights, const int root) : features(features), weights(weights), root(root) {}
+    /*
+    Dense Prim algorithm in O(n^2) over the upper triangle of the weights matrix
+    */
     std::vector<std::pair<int, int>> MST::maximumSpanningTree()
     {
-        auto num_features = features.size();
-        Graph g(num_features);
-        // Make a complete graph
-        for (int i = 0; i < num_features - 1; ++i) {
-            for (int j = i + 1; j < num_features; ++j) {
-                g.addEdge(i, j, weights[i][j].item<float>());
+        const int num_features = features.size();
+        if (num_features < 2) {
+            return {};
+        }
+        const auto matrix = weights.to(torch::kFloat32).contiguous();
+        const float* data = matrix.data_ptr<float>();
+        const int64_t stride = matrix.size(1);
+        auto weight = [data, stride](int i, int j) { return i < j ? data[i * stride + j] : data[j * stride + i]; };
+        // best[v] is the heaviest edge from the tree to v, found[v] tells if v is already in the tree
+        std::vector<bool> found(num_features, false);
+        std::vector<float> bestWeight(num_features);
+        std::vector<std::pair<int, int>> bestEdge(num_features);
+        std::vector<std::pair<float, std::pair<int, int>>> T;
+        found[0] = true;
+        for (int v = 1; v < num_features; ++v) {
+            bestWeight[v] = weight(0, v);
+            bestEdge[v] = { 0, v };
+        }
+        for (int step = 1; step < num_features; ++step) {
+            int next = -1;
+            for (int v = 0; v < num_features; ++v) {
+                if (!found[v] && (next == -1 || heavier(bestWeight[v], bestEdge[v], bestWeight[next], bestEdge[next]))) {
+                    next = v;
+                }
+            }
+            found[next] = true;
+            T.push_back({ bestWeight[next], bestEdge[next] });
+            for (int v = 0; v < num_features; ++v) {
+                if (found[v]) {
+                    continue;
+                }
+                std::pair<int, int> edge = { std::min(next, v), std::max(next, v) };
+                float value = weight(next, v);
+                if (heavier(value, edge, bestWeight[v], bestEdge[v])) {
+                    bestWeight[v] = value;
+                    bestEdge[v] = edge;
+                }
             }
         }
-        g.kruskal_algorithm();
-        auto mst = g.get_mst();
-        return reorder(mst, root);
+        // Same order of the edges as a Kruskal algorithm would have added them
+        std::sort(T.begin(), T.end(), [](const auto& left, const auto& right) { return heavier(left.first, left.second, right.first, right.second); });
+        return reorder(T, root);
     }
 
-}
\ No newline at end of file
+}
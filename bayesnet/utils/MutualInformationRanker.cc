@@ -0,0 +1,115 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include "ContingencyTable.h"
+#include "ThreadPool.h"
+#include "bayesnetUtils.h"
+#include "MutualInformationRanker.h"
+namespace bayesnet {
+    MutualInformationRanker::MutualInformationRanker(const torch::Tensor& samples, const torch::Tensor& weights)
+        : data(samples.to(torch::kInt32).contiguous())
+    {
+        if (weights.size(0) != data.size(1)) {
+            throw std::invalid_argument("Weights (" + std::to_string(weights.size(0)) + ") must have the same number of elements as samples (" + std::to_string(data.size(1)) + ")");
+        }
+        if (data.size(1) > 0 && data.min().item<int>() < 0) {
+            throw std::invalid_argument("Discrete variables can not have negative values");
+        }
+        auto weights_ = weights.to(torch::kFloat64).contiguous();
+        this->weights.assign(weights_.data_ptr<double>(), weights_.data_ptr<double>() + weights_.numel());
+        states.assign(data.size(0), 0);
+        if (data.size(1) > 0) {
+            auto maxValues = data.amax(1).contiguous();
+            std::transform(maxValues.data_ptr<int>(), maxValues.data_ptr<int>() + maxValues.numel(), states.begin(), [](int value) { return value + 1; });
+        }
+        count();
+    }
+    void MutualInformationRanker::count()
+    {
+        const int n_features = data.size(0) - 1;
+        const int64_t n_samples = data.size(1);
+        const int* values = data.data_ptr<int>();
+        counts.assign(n_features, {});
+        ThreadPool::getInstance().parallel_for(0, n_features, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t feature = begin; feature < end; ++feature) {
+                counts[feature] = ContingencyTable::count(values + n_features * n_samples, values + feature * n_samples, weights.data(), n_samples, states.back(), states[feature]);
+            }
+            });
+    }
+    void MutualInformationRanker::update(const torch::Tensor& weights, const torch::Tensor& changed)
+    {
+        const int64_t n_samples = data.size(1);
+        if (weights.size(0) != n_samples || changed.size(0) != n_samples) {
+            throw std::invalid_argument("Weights and changed must have " + std::to_string(n_samples) + " elements in MutualInformationRanker::update");
+        }
+        auto weights_ = weights.to(torch::kFloat64).contiguous();
+        const double* newWeights = weights_.data_ptr<double>();
+        auto changed_ = changed.to(torch::kBool).contiguous();
+        const bool* isChanged = changed_.data_ptr<bool>();
+        // Factor between the new and the old weights of the samples that did not change
+        std::vector<int64_t> rows;
+        double oldTotal = 0;
+        double newTotal = 0;
+        for (int64_t sample = 0; sample < n_samples; ++sample) {
+            if (isChanged[sample]) {
+                rows.push_back(sample);
+            } else {
+                oldTotal += this->weights[sample];
+                newTotal += newWeights[sample];
+            }
+        }
+        const int64_t n_changed = rows.size();
+        if (2 * n_changed > n_samples || oldTotal <= 0) {
+            // Counting again is cheaper or there is no sample left to compute the factor
+            this->weights.assign(newWeights, newWeights + n_samples);
+            count();
+            return;
+        }
+        const double factor = newTotal / oldTotal;
+        const int n_features = data.size(0) - 1;
+        const int* values = data.data_ptr<int>();
+        const int* labels = values + n_features * n_samples;
+        ThreadPool::getInstance().parallel_for(0, n_features, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t feature = begin; feature < end; ++feature) {
+                auto& table = counts[feature];
+                const int* x = values + feature * n_samples;
+                const int statesX = states[feature];
+                for (auto& cell : table) {
+                    cell *= factor;
+                }
+                for (int64_t i = 0; i < n_changed; ++i) {
+                    int64_t sample = rows[i];
+                    table[labels[sample] * statesX + x[sample]] += newWeights[sample] - factor * this->weights[sample];
+                }
+            }
+            });
+        this->weights.assign(newWeights, newWeights + n_samples);
+    }
+    std::vector<int> MutualInformationRanker::SelectKBest(bool ascending, unsigned k)
+    {
+        const int n = counts.size();
+        scores.clear();
+        for (int i = 0; i < n; ++i) {
+            // I(C;Xi) = H(C) - H(C|Xi)
+            scores.push_back(std::max(ContingencyTable::mutualInformation(counts[i].data(), states.back(), states[i]), 0.0));
+        }
+        // sort & reduce scores and features, as in Metrics::SelectKBestWeighted
+        auto featuresKBest = selectKBest(scores, ascending, k);
+        std::vector<double> selected;
+        for (int feature : featuresKBest) {
+            selected.push_back(scores[feature]);
+        }
+        scores = selected;
+        return featuresKBest;
+    }
+    std::vector<double> MutualInformationRanker::getScores() const
+    {
+        return scores;
+    }
+}
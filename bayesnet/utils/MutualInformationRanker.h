@@ -0,0 +1,39 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#ifndef MUTUAL_INFORMATION_RANKER_H
+#define MUTUAL_INFORMATION_RANKER_H
+#include <vector>
+#include <torch/torch.h>
+namespace bayesnet {
+    /*
+    Ranks the features by their weighted mutual information with the class, I(Xi;C), keeping the
+    weighted histograms counts[c][xi] of every feature between rankings.
+    The mutual information does not change if all the weights are scaled by the same factor, so when
+    the weights change (as in a boosting round) only the samples whose weight changed relative to the
+    rest have to be counted again.
+    */
+    class MutualInformationRanker {
+    public:
+        MutualInformationRanker() = default;
+        // samples is n+1xm with the class in the last row, weights has m elements
+        MutualInformationRanker(const torch::Tensor& samples, const torch::Tensor& weights);
+        // changed[i] is true if the weight of the i-th sample changed relative to the weights of the samples not changed,
+        // the rest of the weights can only differ from the previous ones by a common factor
+        void update(const torch::Tensor& weights, const torch::Tensor& changed);
+        // Same result as Metrics::SelectKBestWeighted with the current weights
+        std::vector<int> SelectKBest(bool ascending = false, unsigned k = 0);
+        std::vector<double> getScores() const;
+    private:
+        void count();
+        torch::Tensor data; // n+1xm contiguous int32 samples
+        std::vector<double> weights;
+        std::vector<int> states; // number of states of every row of data
+        std::vector<std::vector<double>> counts; // counts[feature][c][x]
+        std::vector<double> scores;
+    };
+}
+#endif
@@ -0,0 +1,101 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#include <algorithm>
+#include "StatisticsCache.h"
+
+namespace bayesnet {
+    StatisticsCache::StatisticsCache(const torch::Tensor& samples) : samples(samples)
+    {
+    }
+    bool StatisticsCache::matches(const torch::Tensor& other) const
+    {
+        return other.defined() && other.data_ptr() == samples.data_ptr() && other.scalar_type() == samples.scalar_type()
+            && other.sizes() == samples.sizes() && other.strides() == samples.strides();
+    }
+    // FNV-1a hash of the bytes of the weights as doubles
+    uint64_t StatisticsCache::hashWeights(const torch::Tensor& weights)
+    {
+        auto values = weights.to(torch::kFloat64).contiguous();
+        const auto* bytes = reinterpret_cast<const unsigned char*>(values.data_ptr<double>());
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < values.numel() * sizeof(double); ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+    int64_t StatisticsCache::getWeightsVersion(const torch::Tensor& weights)
+    {
+        auto hash = hashWeights(weights);
+        auto weights_ = weights.to(torch::kFloat64);
+        std::lock_guard<std::mutex> lock(mtx);
+        auto& bucket = versions[hash];
+        for (const auto& [stored, version] : bucket) {
+            if (stored.equal(weights_)) {
+                return version;
+            }
+        }
+        bucket.emplace_back(weights_.clone(), numVersions);
+        kept.emplace_back(hash, numVersions);
+        if (kept.size() > maxWeightsVersions) {
+            // Drop the oldest weights and the statistics computed with them
+            auto [oldHash, oldVersion] = kept.front();
+            kept.pop_front();
+            auto& oldBucket = versions[oldHash];
+            oldBucket.erase(std::remove_if(oldBucket.begin(), oldBucket.end(), [oldVersion = oldVersion](const auto& stored) { return stored.second == oldVersion; }), oldBucket.end());
+            if (oldBucket.empty()) {
+                versions.erase(oldHash);
+            }
+            for (auto it = entries.begin(); it != entries.end();) {
+                it = it->first.second == oldVersion ? entries.erase(it) : std::next(it);
+            }
+        }
+        return numVersions++;
+    }
+    torch::Tensor StatisticsCache::get(const std::string& name, const torch::Tensor& weights, const std::function<torch::Tensor()>& compute)
+    {
+        return get(name, getWeightsVersion(weights), compute);
+    }
+    torch::Tensor StatisticsCache::get(const std::string& name, int64_t version, const std::function<torch::Tensor()>& compute)
+    {
+        auto key = std::make_pair(name, version);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = entries.find(key);
+            if (it != entries.end()) {
+                ++hits;
+                return it->second;
+            }
+            ++misses;
+        }
+        // Computed without the lock, two threads may compute the same statistic and the first one is kept
+        auto value = compute();
+        std::lock_guard<std::mutex> lock(mtx);
+        if (std::none_of(kept.begin(), kept.end(), [version](const auto& stored) { return stored.second == version; })) {
+            return value; // the weights were dropped, storing it would never be freed
+        }
+        return entries.emplace(key, value).first->second;
+    }
+    void StatisticsCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        entries.clear();
+        versions.clear();
+        kept.clear();
+        hits = 0;
+        misses = 0;
+    }
+    size_t StatisticsCache::getNumWeightsVersions() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return kept.size();
+    }
+    size_t StatisticsCache::size() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return entries.size();
+    }
+}
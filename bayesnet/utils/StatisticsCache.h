@@ -0,0 +1,58 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#ifndef STATISTICS_CACHE_H
+#define STATISTICS_CACHE_H
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <torch/torch.h>
+namespace bayesnet {
+    /*
+    Statistics of one dataset shared by all the classifiers trained on it, so a model selection run
+    over several algorithms computes every I(Xi;C), I(Xi;Xj|C), ... only once.
+    Every distinct weights vector is stored once and gets a version number, the statistics are stored
+    under their name and the version of the weights they were computed with.
+    Only the last maxWeightsVersions weights are kept, so the weights of the iterations of a boosting run
+    are dropped, with their statistics, as new ones come.
+    The cache is thread safe and can be shared between threads.
+    */
+    class StatisticsCache {
+    public:
+        // samples is the n+1xm dataset of the classifiers with the class in the last row, it is shared, not copied
+        explicit StatisticsCache(const torch::Tensor& samples);
+        // True if samples is the tensor of the cache (same storage, shape and type), only then can a classifier use the cache
+        bool matches(const torch::Tensor& samples) const;
+        static constexpr size_t maxWeightsVersions = 16;
+        // Version of weights, equal weights get the same version while they are kept
+        int64_t getWeightsVersion(const torch::Tensor& weights);
+        // Returns the statistic name computed with the weights of version, calling compute and storing its result if missing
+        // and the version is still kept
+        torch::Tensor get(const std::string& name, int64_t version, const std::function<torch::Tensor()>& compute);
+        torch::Tensor get(const std::string& name, const torch::Tensor& weights, const std::function<torch::Tensor()>& compute);
+        static uint64_t hashWeights(const torch::Tensor& weights);
+        void clear();
+        int64_t getHits() const { return hits; }
+        int64_t getMisses() const { return misses; }
+        size_t size() const;
+        size_t getNumWeightsVersions() const;
+    private:
+        torch::Tensor samples;
+        std::map<uint64_t, std::vector<std::pair<torch::Tensor, int64_t>>> versions; // weights by hash with their version
+        std::deque<std::pair<uint64_t, int64_t>> kept; // hash and version of the weights kept, oldest first
+        int64_t numVersions = 0;
+        std::map<std::pair<std::string, int64_t>, torch::Tensor> entries;
+        mutable std::mutex mtx;
+        std::atomic<int64_t> hits{ 0 };
+        std::atomic<int64_t> misses{ 0 };
+    };
+}
+#endif
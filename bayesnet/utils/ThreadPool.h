@@ -0,0 +1,201 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+
+namespace bayesnet {
+    /*
+    Library wide pool of persistent worker threads.
+    Every worker owns a deque of tasks: it pops its own tasks from the back and steals from the front
+    of the other workers' deques when it runs out of work.
+    parallel_for splits a range in chunks and blocks until all of them are done, the calling thread
+    runs pending tasks while it waits, so parallel_for can be nested inside a task.
+    */
+    class ThreadPool {
+    public:
+        static ThreadPool& getInstance()
+        {
+            static ThreadPool instance;
+            return instance;
+        }
+        // Delete copy constructor and assignment operator
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                stop_ = true;
+            }
+            cv_.notify_all();
+            for (auto& worker : workers_) {
+                worker.join();
+            }
+        }
+        unsigned getNumThreads() const
+        {
+            return static_cast<unsigned>(workers_.size());
+        }
+        // Calls body(from, to) for consecutive chunks of at most chunk elements of [begin, end)
+        template<typename F>
+        void parallel_for(int64_t begin, int64_t end, int64_t chunk, F&& body)
+        {
+            if (end <= begin) {
+                return;
+            }
+            chunk = std::max<int64_t>(1, chunk);
+            if (end - begin <= chunk || workers_.size() < 2) {
+                body(begin, end);
+                return;
+            }
+            auto batch = std::make_shared<Batch>();
+            batch->remaining = (end - begin + chunk - 1) / chunk;
+            for (int64_t from = begin; from < end; from += chunk) {
+                int64_t to = std::min(from + chunk, end);
+                submit([batch, &body, from, to]() {
+                    try {
+                        body(from, to);
+                    }
+                    catch (...) {
+                        std::lock_guard<std::mutex> lock(batch->mtx);
+                        if (!batch->error) {
+                            batch->error = std::current_exception();
+                        }
+                    }
+                    if (--batch->remaining == 0) {
+                        std::lock_guard<std::mutex> lock(batch->mtx);
+                        batch->cv.notify_all();
+                    }
+                    });
+            }
+            // Help with the pending work instead of sleeping
+            while (batch->remaining > 0) {
+                if (runPendingTask()) {
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(batch->mtx);
+                batch->cv.wait(lock, [&batch]() { return batch->remaining == 0; });
+            }
+            if (batch->error) {
+                std::rethrow_exception(batch->error);
+            }
+        }
+        // Chunk size chosen to give every worker a few chunks to balance the load
+        template<typename F>
+        void parallel_for(int64_t begin, int64_t end, F&& body)
+        {
+            int64_t chunk = (end - begin) / (4 * static_cast<int64_t>(std::max<size_t>(1, workers_.size())));
+            parallel_for(begin, end, chunk, std::forward<F>(body));
+        }
+    private:
+        using Task = std::function<void()>;
+        struct Queue {
+            std::mutex mtx;
+            std::deque<Task> tasks;
+        };
+        struct Batch {
+            std::atomic<int64_t> remaining{ 0 };
+            std::mutex mtx;
+            std::condition_variable cv;
+            std::exception_ptr error;
+        };
+        ThreadPool()
+        {
+            unsigned numThreads = std::max(1u, static_cast<unsigned>(0.95 * std::thread::hardware_concurrency()));
+            for (unsigned i = 0; i < numThreads; ++i) {
+                queues_.push_back(std::make_unique<Queue>());
+            }
+            for (unsigned i = 0; i < numThreads; ++i) {
+                workers_.emplace_back(&ThreadPool::workerLoop, this, static_cast<int>(i));
+            }
+        }
+        void submit(Task task)
+        {
+            // Workers push to their own queue, other threads spread the tasks round robin
+            size_t index = workerIndex_ >= 0 ? workerIndex_ : next_++ % queues_.size();
+            {
+                // Counted before it is queued so pending_ never goes below zero
+                std::lock_guard<std::mutex> lock(mtx_);
+                ++pending_;
+            }
+            {
+                std::lock_guard<std::mutex> lock(queues_[index]->mtx);
+                queues_[index]->tasks.push_back(std::move(task));
+            }
+            cv_.notify_one();
+        }
+        // Runs one task from the own queue or stolen from another one, false if there was none
+        bool runPendingTask()
+        {
+            Task task;
+            size_t size = queues_.size();
+            size_t start = workerIndex_ >= 0 ? workerIndex_ : next_ % size;
+            for (size_t i = 0; i < size && !task; ++i) {
+                auto& queue = *queues_[(start + i) % size];
+                std::lock_guard<std::mutex> lock(queue.mtx);
+                if (queue.tasks.empty()) {
+                    continue;
+                }
+                if (i == 0 && workerIndex_ >= 0) {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                } else {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+                --pending_;
+            }
+            if (!task) {
+                return false;
+            }
+            task();
+            return true;
+        }
+        void workerLoop(int index)
+        {
+            workerIndex_ = index;
+            std::string threadName = "BayesWorker-" + std::to_string(index);
+#if defined(__linux__)
+            pthread_setname_np(pthread_self(), threadName.c_str());
+#else
+            pthread_setname_np(threadName.c_str());
+#endif
+            while (true) {
+                if (runPendingTask()) {
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [this]() { return stop_ || pending_ > 0; });
+                if (stop_ && pending_ == 0) {
+                    return;
+                }
+            }
+        }
+        std::vector<std::unique_ptr<Queue>> queues_;
+        std::vector<std::thread> workers_;
+        std::mutex mtx_;
+        std::condition_variable cv_;
+        std::atomic<int64_t> pending_{ 0 }; // tasks queued and not taken yet
+        std::atomic<size_t> next_{ 0 };
+        bool stop_ = false;
+        static inline thread_local int workerIndex_ = -1;
+    };
+}
+#endif
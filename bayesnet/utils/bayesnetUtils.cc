@@ -4,7 +4,8 @@
 // SPDX-License-Identifier: MIT
 // ***************************************************************
 
-
+#include <algorithm>
+#include <numeric>
 #include "bayesnetUtils.h"
 namespace bayesnet {
     // Return the indices in descending order
@@ -16,6 +17,26 @@ namespace bayesnet {
         sort(indices.begin(), indices.end(), [&nums](int i, int j) {return nums[i] > nums[j];});
         return indices;
     }
+    std::vector<int> selectKBest(const std::vector<double>& scores, bool ascending, unsigned k)
+    {
+        const int n = scores.size();
+        if (k == 0 || k > n) {
+            k = n;
+        }
+        std::vector<int> indices(n);
+        iota(indices.begin(), indices.end(), 0);
+        if (!ascending) {
+            auto higher = [&scores](int i, int j) { return scores[i] > scores[j] || (scores[i] == scores[j] && i < j); };
+            partial_sort(indices.begin(), indices.begin() + k, indices.end(), higher);
+            indices.resize(k);
+            return indices;
+        }
+        auto lower = [&scores](int i, int j) { return scores[i] < scores[j] || (scores[i] == scores[j] && i < j); };
+        auto first = indices.begin() + (n - k);
+        nth_element(indices.begin(), first, indices.end(), lower);
+        sort(first, indices.end(), lower);
+        return std::vector<int>(first, indices.end());
+    }
     std::vector<std::vector<double>> tensorToVectorDouble(torch::Tensor& dtensor)
     {
         // convert mxn tensor to mxn std::vector
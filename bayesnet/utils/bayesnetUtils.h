@@ -10,6 +10,9 @@
 #include <torch/torch.h>
 namespace bayesnet {
     std::vector<int> argsort(std::vector<double>& nums);
+    // Indices of the k highest scores (all of them if k is 0), from the highest to the lowest or, if ascending,
+    // from the lowest to the highest. Ties are ordered by index, as a stable sort would do
+    std::vector<int> selectKBest(const std::vector<double>& scores, bool ascending, unsigned k);
     std::vector<std::vector<double>> tensorToVectorDouble(torch::Tensor& dtensor);
     torch::Tensor vectorToTensor(std::vector<std::vector<int>>& vector, bool transpose = true);
 }
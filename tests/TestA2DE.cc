@@ -9,6 +9,7 @@
 #include <catch2/catch_approx.hpp>
 #include <catch2/generators/catch_generators.hpp>
 #include "bayesnet/ensembles/A2DE.h"
+#include "bayesnet/classifiers/SPnDE.h"
 #include "TestUtils.h"
 
 
@@ -47,3 +48,22 @@ TEST_CASE("Test graph", "[A2DE]")
     REQUIRE(graph[0] == "digraph BayesNet {\nlabel=<BayesNet A2DE_0>\nfontsize=30\nfontcolor=blue\nlabelloc=t\nlayout=circo\n");
     REQUIRE(graph[1] == "\"class\" [shape=circle, fontcolor=red, fillcolor=lightblue, style=filled ] \n");
 }
+TEST_CASE("Members fitted in parallel", "[A2DE]")
+{
+    auto raw = RawDatasets("glass", true);
+    auto clf = bayesnet::A2DE();
+    clf.fit(raw.dataset, raw.features, raw.className, raw.states, raw.smoothing);
+    // Every member is the same as the SPnDE fitted alone on its pair of features
+    auto expected = torch::zeros({ raw.Xt.size(1), raw.classNumStates }, torch::kFloat32);
+    int n_models = 0;
+    for (int i = 0; i < static_cast<int>(raw.features.size()) - 1; ++i) {
+        for (int j = i + 1; j < static_cast<int>(raw.features.size()); ++j) {
+            auto model = bayesnet::SPnDE({ i, j });
+            model.fit(raw.dataset, raw.features, raw.className, raw.states, raw.smoothing);
+            expected += model.predict_proba(raw.Xt);
+            n_models++;
+        }
+    }
+    expected /= n_models;
+    REQUIRE(torch::allclose(clf.predict_proba(raw.Xt), expected));
+}
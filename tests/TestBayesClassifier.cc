@@ -11,6 +11,9 @@
 #include "bayesnet/classifiers/TAN.h"
 #include "bayesnet/classifiers/KDB.h"
 #include "bayesnet/classifiers/KDBLd.h"
+#include "bayesnet/classifiers/SPODELd.h"
+#include "bayesnet/classifiers/TANLd.h"
+#include "bayesnet/ensembles/AODELd.h"
 
 
 TEST_CASE("Test Cannot build dataset with wrong data vector", "[Classifier]")
@@ -107,6 +110,64 @@ TEST_CASE("Not fitted model", "[Classifier]")
     REQUIRE_THROWS_AS(model.score(raw.Xv, raw.yv), std::logic_error);
     REQUIRE_THROWS_WITH(model.score(raw.Xv, raw.yv), message);
 }
+TEST_CASE("Partial fit", "[Classifier]")
+{
+    auto model = bayesnet::TAN();
+    auto raw = RawDatasets("iris", true);
+    auto weights = torch::full({ raw.Xt.size(1) }, 1.0 / raw.Xt.size(1), torch::kDouble);
+    REQUIRE_THROWS_AS(model.partial_fit(raw.Xt, raw.yt, weights), std::logic_error);
+    REQUIRE_THROWS_WITH(model.partial_fit(raw.Xt, raw.yt, weights), "Classifier has not been fitted");
+    model.fit(raw.Xt, raw.yt, raw.features, raw.className, raw.states, bayesnet::Smoothing_t::NONE);
+    auto proba = model.predict_proba(raw.Xt);
+    // Without smoothing, adding the same samples again with the same weights leaves the CPTs unchanged
+    model.partial_fit(raw.Xt, raw.yt, weights);
+    REQUIRE(model.getModel().getNumSamples() == 2 * raw.Xt.size(1));
+    REQUIRE(model.getModel().getSamples().size(1) == raw.Xt.size(1));
+    REQUIRE(torch::allclose(model.predict_proba(raw.Xt), proba));
+}
+TEST_CASE("Partial fit of a split dataset", "[Classifier]")
+{
+    // ORIGINAL smoothing depends on the number of samples, so it has to be the total after the partial fit
+    auto raw = RawDatasets("iris", true);
+    auto model = bayesnet::TAN();
+    auto expected = bayesnet::TAN();
+    expected.fit(raw.Xt, raw.yt, raw.features, raw.className, raw.states, bayesnet::Smoothing_t::ORIGINAL);
+    auto half = raw.Xt.size(1) / 2;
+    auto rest = raw.Xt.size(1) - half;
+    auto weights = torch::full({ raw.Xt.size(1) }, 1.0 / raw.Xt.size(1), torch::kDouble);
+    auto first = raw.dataset.narrow(1, 0, half);
+    model.fit(first, raw.features, raw.className, raw.states, weights.narrow(0, 0, half), bayesnet::Smoothing_t::ORIGINAL);
+    auto X = raw.Xt.narrow(1, half, rest);
+    auto y = raw.yt.narrow(0, half, rest);
+    model.partial_fit(X, y, weights.narrow(0, half, rest));
+    REQUIRE(model.getModel().getNumSamples() == raw.Xt.size(1));
+    for (const auto& [name, node] : expected.getModel().getNodes()) {
+        REQUIRE(torch::allclose(node->getCPT(), model.getModel().getNodes().at(name)->getCPT()));
+    }
+    REQUIRE(torch::allclose(model.predict_proba(raw.Xt), expected.predict_proba(raw.Xt)));
+}
+TEST_CASE("Partial fit of local discretization models", "[Classifier]")
+{
+    // The continuous samples are discretized with the cut points found by fit
+    auto raw = RawDatasets("iris", false);
+    std::map<std::string, std::unique_ptr<bayesnet::Classifier>> models;
+    models["TANLd"] = std::make_unique<bayesnet::TANLd>();
+    models["KDBLd"] = std::make_unique<bayesnet::KDBLd>(2);
+    models["SPODELd"] = std::make_unique<bayesnet::SPODELd>(0);
+    models["AODELd"] = std::make_unique<bayesnet::AODELd>();
+    auto weights = torch::full({ raw.Xt.size(1) }, 1.0 / raw.Xt.size(1), torch::kDouble);
+    for (auto& [name, model] : models) {
+        INFO("Model: " << name);
+        REQUIRE_THROWS_AS(model->partial_fit(raw.Xt, raw.yt, weights), std::logic_error);
+        model->fit(raw.Xt, raw.yt, raw.features, raw.className, raw.states, bayesnet::Smoothing_t::NONE);
+        auto proba = model->predict_proba(raw.Xt);
+        // Adding the same samples again doubles every count and leaves the CPTs unchanged
+        model->partial_fit(raw.Xt, raw.yt, weights);
+        REQUIRE(torch::allclose(model->predict_proba(raw.Xt), proba));
+        auto discrete = raw.Xt.to(torch::kInt32);
+        REQUIRE_THROWS_AS(model->partial_fit(discrete, raw.yt, weights), std::invalid_argument);
+    }
+}
 TEST_CASE("KDB Graph", "[Classifier]")
 {
     auto model = bayesnet::KDB(2);
@@ -4,13 +4,17 @@
 // SPDX-License-Identifier: MIT
 // ***************************************************************
 
+#include <numeric>
+#include <thread>
 #include <type_traits>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_approx.hpp>
 #include <catch2/generators/catch_generators.hpp>
 #include "bayesnet/ensembles/BoostAODE.h"
+#include "bayesnet/ensembles/ProbabilityAccumulator.h"
 #include "bayesnet/ensembles/AODE.h"
 #include "bayesnet/ensembles/AODELd.h"
+#include "bayesnet/ensembles/XBAODE.h"
 #include "TestUtils.h"
 
 
@@ -123,4 +127,126 @@ TEST_CASE("Compute ArgMax", "[Ensemble]")
     REQUIRE(argmaxt.size(0) == expected.size());
     for (int i = 0; i < argmaxt.size(0); i++)
         REQUIRE(argmaxt[i].item<int>() == expected[i]);
-}
\ No newline at end of file
+}
+TEST_CASE("Probability accumulator", "[Ensemble]")
+{
+    class TestEnsemble : public bayesnet::BoostAODE {
+    public:
+        explicit TestEnsemble(bool voting) : bayesnet::BoostAODE(voting) {}
+        bayesnet::Classifier& model(int i) { return *models.at(i); }
+        std::vector<double> significances() const { return significanceModels; }
+    };
+    auto voting = GENERATE(false, true);
+    auto raw = RawDatasets("glass", true);
+    TestEnsemble clf(voting);
+    clf.setHyperparameters({ {"convergence", false} });
+    clf.fit(raw.Xv, raw.yv, raw.features, raw.className, raw.states, raw.smoothing);
+    auto significances = clf.significances();
+    REQUIRE(significances.size() > 2);
+    auto sums = bayesnet::ProbabilityAccumulator(raw.Xt, raw.classNumStates, voting);
+    auto vsums = bayesnet::ProbabilityAccumulator(raw.Xv, raw.classNumStates, voting);
+    for (int i = 0; i < static_cast<int>(significances.size()); ++i) {
+        sums.add(sums.contribution(clf.model(i)), significances[i]);
+        vsums.add(vsums.contribution(clf.model(i)), significances[i]);
+    }
+    REQUIRE(sums.size() == static_cast<int>(significances.size()));
+    auto expected = clf.predict(raw.Xt);
+    auto expectedv = clf.predict(raw.Xv);
+    REQUIRE(torch::equal(sums.predict(), expected));
+    REQUIRE(torch::equal(vsums.predict().to(torch::kInt32), torch::tensor(expectedv, torch::kInt32)));
+    // Predicting with the last model as an extra one gives the same prediction
+    auto last = sums.contribution(clf.model(sums.size() - 1));
+    auto lastSignificance = significances.back();
+    sums.removeLast();
+    significances.pop_back();
+    REQUIRE(sums.size() == static_cast<int>(significances.size()));
+    sums.setSignificances(significances);
+    REQUIRE(torch::equal(sums.predict(last, lastSignificance), expected));
+    sums.add(last, lastSignificance);
+    // The significances can be changed without running the models again
+    std::vector<double> ones(sums.size(), 1.0);
+    sums.setSignificances(ones);
+    REQUIRE(torch::equal(sums.predictLast(sums.size()), sums.predict()));
+}
+TEST_CASE("Fused ensemble inference", "[Ensemble]")
+{
+    class TestEnsemble : public bayesnet::AODE {
+    public:
+        explicit TestEnsemble(bool voting) : bayesnet::AODE(voting) {}
+        bayesnet::Classifier& model(int i) { return *models.at(i); }
+        int size() const { return n_models; }
+        bool fused() const { return getEnsemblePlan() != nullptr; }
+    };
+    auto voting = GENERATE(false, true);
+    auto raw = RawDatasets("glass", true);
+    TestEnsemble clf(voting);
+    clf.fit(raw.Xv, raw.yv, raw.features, raw.className, raw.states, raw.smoothing);
+    // Average of the predictions of the members one by one
+    auto expected = torch::zeros({ raw.Xt.size(1), raw.classNumStates }, torch::kFloat32);
+    for (int i = 0; i < clf.size(); ++i) {
+        REQUIRE(clf.model(i).getInferencePlan() != nullptr);
+        if (voting) {
+            auto votes = clf.model(i).predict(raw.Xt).to(torch::kInt64);
+            expected.scatter_add_(1, votes.unsqueeze(1), torch::ones({ votes.size(0), 1 }, torch::kFloat32));
+        } else {
+            expected += clf.model(i).predict_proba(raw.Xt);
+        }
+    }
+    expected /= clf.size();
+    REQUIRE(torch::allclose(clf.predict_proba(raw.Xt), expected));
+    auto probav = clf.predict_proba(raw.Xv);
+    for (int i = 0; i < expected.size(0); ++i) {
+        for (int c = 0; c < raw.classNumStates; ++c) {
+            REQUIRE(probav[i][c] == Catch::Approx(expected[i][c].item<float>()).epsilon(raw.epsilon));
+        }
+    }
+    // Values out of range are detected as in the members
+    auto X = raw.Xt.clone();
+    X[0][0] = 100;
+    REQUIRE_THROWS_AS(clf.predict_proba(X), std::out_of_range);
+    // The plan is built by fit and only read by predict
+    REQUIRE(clf.fused());
+    auto proba = clf.predict_proba(raw.Xt);
+    std::vector<torch::Tensor> results(4);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < results.size(); ++i) {
+        threads.emplace_back([&, i]() { results[i] = clf.predict_proba(raw.Xt); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& result : results) {
+        REQUIRE(torch::equal(result, proba));
+    }
+    // partial_fit builds the plan of the updated models
+    auto weights = torch::full({ raw.Xt.size(1) }, 1.0 / raw.Xt.size(1), torch::kDouble);
+    clf.partial_fit(raw.Xt, raw.yt, weights);
+    REQUIRE(clf.fused());
+}
+TEST_CASE("Voting with weighted models", "[Ensemble]")
+{
+    // XSpode members are not fused, so the votes of the models are counted by Ensemble::voting
+    class TestEnsemble : public bayesnet::XBAODE {
+    public:
+        bayesnet::Classifier& model(int i) { return *models.at(i); }
+        std::vector<double> significances() const { return significanceModels; }
+    };
+    auto raw = RawDatasets("glass", true);
+    TestEnsemble clf;
+    clf.setHyperparameters({ {"predict_voting", true} });
+    clf.fit(raw.Xv, raw.yv, raw.features, raw.className, raw.states, raw.smoothing);
+    auto significances = clf.significances();
+    REQUIRE(significances.size() > 1);
+    auto votes = torch::zeros({ raw.Xt.size(1), raw.classNumStates }, torch::kFloat64);
+    for (int i = 0; i < static_cast<int>(significances.size()); ++i) {
+        auto y_pred = clf.model(i).predict(raw.Xt);
+        for (int j = 0; j < y_pred.size(0); ++j) {
+            votes[j][y_pred[j].item<int>()] += significances[i];
+        }
+    }
+    auto expected = votes.to(torch::kFloat32) / std::reduce(significances.begin(), significances.end());
+    REQUIRE(torch::allclose(clf.predict_proba(raw.Xt), expected));
+    REQUIRE(torch::equal(clf.predict(raw.Xt), expected.argmax(1)));
+    auto accuracy = (expected.argmax(1) == raw.yt).sum().item<double>() / raw.yt.size(0);
+    REQUIRE(clf.score(raw.Xt, raw.yt) == Catch::Approx(accuracy));
+}
@@ -4,10 +4,14 @@
 // SPDX-License-Identifier: MIT
 // ***************************************************************
 
+#include <set>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_approx.hpp>
 #include <catch2/generators/catch_generators.hpp>
 #include "bayesnet/utils/BayesMetrics.h"
+#include "bayesnet/utils/ContingencyTable.h"
+#include "bayesnet/utils/MutualInformationRanker.h"
+#include "bayesnet/utils/bayesnetUtils.h"
 #include "TestUtils.h"
 #include "Timer.h"
 
@@ -215,6 +219,23 @@ TEST_CASE("Select K Pairs with features excluded", "[Metrics]")
     REQUIRE(results.size() == 1);
     REQUIRE(scores.size() == 1);
 }
+TEST_CASE("Select K Pairs of every pair", "[Metrics]")
+{
+    auto raw = RawDatasets("glass", true);
+    bayesnet::Metrics metrics(raw.dataset, raw.features, raw.className, raw.classNumStates);
+    std::vector<int> empty;
+    auto results = metrics.SelectKPairs(raw.weights, empty, false, 0);
+    int nIds = raw.features.size();
+    REQUIRE(results.size() == nIds * (nIds - 1) / 2);
+    REQUIRE(metrics.getScoresKPairs().size() == nIds * (nIds - 1) / 2);
+    std::set<std::pair<int, int>> unique(results.begin(), results.end());
+    REQUIRE(unique.size() == results.size());
+    for (const auto& [first, second] : results) {
+        REQUIRE(first >= 0);
+        REQUIRE(first < second);
+        REQUIRE(second < nIds);
+    }
+}
 TEST_CASE("Select K Pairs with number of pairs descending", "[Metrics]")
 {
     auto raw = RawDatasets("iris", true);
@@ -264,4 +285,209 @@ TEST_CASE("Select K Pairs with number of pairs ascending", "[Metrics]")
         REQUIRE(score.first.second == expect.first.second);
         REQUIRE(score.second == Catch::Approx(expect.second).epsilon(raw.epsilon));
     }
-}
\ No newline at end of file
+}
+TEST_CASE("Contingency table", "[Metrics]")
+{
+    std::vector<int> x = { 0, 0, 1, 1, 1, 2 };
+    std::vector<int> y = { 0, 1, 0, 0, 1, 1 };
+    std::vector<double> weights = { 1.0, 1.0, 0.5, 0.5, 1.0, 0.0 };
+    auto counts = bayesnet::ContingencyTable::count(x.data(), y.data(), weights.data(), x.size(), 3, 2);
+    REQUIRE(counts == std::vector<double>({ 1.0, 1.0, 1.0, 1.0, 0.0, 0.0 }));
+    // H(Y|X) = p(x=0) H(Y|x=0) + p(x=1) H(Y|x=1), the sample with no weight does not count
+    REQUIRE(bayesnet::ContingencyTable::conditionalEntropy(counts, 2) == Catch::Approx(std::log(2.0)));
+    REQUIRE(bayesnet::ContingencyTable::entropy(bayesnet::ContingencyTable::count(x.data(), weights.data(), x.size(), 3)) == Catch::Approx(std::log(2.0)));
+    REQUIRE(bayesnet::ContingencyTable::entropy(std::vector<double>(3, 0.0)) == 0.0);
+    // Same values through the tensor interface
+    auto raw = RawDatasets("iris", true);
+    bayesnet::Metrics metrics(raw.dataset, raw.features, raw.className, raw.classNumStates);
+    auto tx = torch::tensor(x, torch::kInt32);
+    auto ty = torch::tensor(y, torch::kInt32);
+    auto tw = torch::tensor(weights, torch::kDouble);
+    REQUIRE(metrics.mutualInformation(ty, tx, tw) == Catch::Approx(metrics.entropy(ty, tw) - std::log(2.0)).margin(1e-12));
+    REQUIRE_THROWS_AS(metrics.entropy(torch::tensor({ 0, -1 }, torch::kInt32), torch::ones({ 2 }, torch::kDouble)), std::invalid_argument);
+}
+TEST_CASE("Conditional edge matrix", "[Metrics]")
+{
+    auto raw = RawDatasets("glass", true);
+    bayesnet::Metrics metrics(raw.dataset, raw.features, raw.className, raw.classNumStates);
+    auto matrix = metrics.conditionalEdge(raw.weights);
+    int n = raw.features.size();
+    REQUIRE(matrix.size(0) == n + 1);
+    auto labels = raw.dataset.index({ -1, "..." });
+    for (int i = 0; i < n; ++i) {
+        REQUIRE(matrix[i][n].item<float>() == 0.0f);
+        for (int j = i + 1; j < n; ++j) {
+            // sum_c p(c) I(Xi;Xj|C=c)
+            double expected = 0;
+            for (int value = 0; value < raw.classNumStates; ++value) {
+                auto mask = labels == value;
+                double pc = mask.sum().item<double>() / labels.size(0);
+                expected += pc * metrics.mutualInformation(raw.dataset.index({ i, mask }), raw.dataset.index({ j, mask }), raw.weights.index({ mask }));
+            }
+            REQUIRE(matrix[i][j].item<float>() == Catch::Approx(expected).epsilon(raw.epsilon).margin(1e-6));
+            REQUIRE(matrix[j][i].item<float>() == matrix[i][j].item<float>());
+        }
+    }
+}
+TEST_CASE("Incremental mutual information ranking", "[Metrics]")
+{
+    auto raw = RawDatasets("glass", true);
+    bayesnet::Metrics metrics(raw.dataset, raw.features, raw.className, raw.classNumStates);
+    auto weights = raw.weights.clone();
+    bayesnet::MutualInformationRanker ranker(raw.dataset, weights);
+    auto n = raw.features.size();
+    REQUIRE(ranker.SelectKBest(false, n) == metrics.SelectKBestWeighted(weights, false, n));
+    // Boosting like rounds: the misclassified samples gain weight and the weights are normalized
+    for (int round = 1; round < 4; ++round) {
+        auto wrong = torch::arange(weights.size(0)).remainder(round + 2) == 0;
+        auto factor = torch::where(wrong, torch::full_like(weights, std::exp(0.3 * round)), torch::full_like(weights, std::exp(-0.3 * round)));
+        weights = weights * factor;
+        weights = weights / weights.sum();
+        ranker.update(weights, wrong);
+        auto expected = metrics.SelectKBestWeighted(weights, true, 5);
+        REQUIRE(ranker.SelectKBest(true, 5) == expected);
+        auto scores = ranker.getScores();
+        auto expectedScores = metrics.getScoresKBest();
+        for (int i = 0; i < scores.size(); ++i) {
+            REQUIRE(scores[i] == Catch::Approx(expectedScores[i]).epsilon(raw.epsilon));
+        }
+    }
+    // Every sample changed
+    weights = torch::rand({ weights.size(0) }, torch::kFloat64);
+    ranker.update(weights, torch::ones({ weights.size(0) }, torch::kBool));
+    REQUIRE(ranker.SelectKBest(false, n) == metrics.SelectKBestWeighted(weights, false, n));
+    REQUIRE_THROWS_AS(ranker.update(weights.narrow(0, 0, 3), torch::ones({ 3 }, torch::kBool)), std::invalid_argument);
+}
+TEST_CASE("Select K Best ties", "[Metrics]")
+{
+    auto raw = RawDatasets("iris", true);
+    // Features 0 and 2 are the same, so are features 1 and 3: ties are ordered by index
+    auto X = raw.dataset.index_select(0, torch::tensor({ 0, 1, 0, 1, 4 }, torch::kInt64));
+    std::vector<std::string> features = { "a", "b", "c", "d" };
+    bayesnet::Metrics metrics(X, features, raw.className, raw.classNumStates);
+    auto descending = metrics.SelectKBestWeighted(raw.weights, false, 0);
+    auto scores = metrics.getScoresKBest();
+    REQUIRE(descending.size() == 4);
+    for (int i = 0; i < 4; i += 2) {
+        REQUIRE(scores[i] == scores[i + 1]);
+        REQUIRE(descending[i] < descending[i + 1]);
+    }
+    auto ascending = metrics.SelectKBestWeighted(raw.weights, true, 3);
+    REQUIRE(ascending == std::vector<int>({ descending[2] == 1 ? 3 : 2, descending[0], descending[1] }));
+    REQUIRE(bayesnet::selectKBest({ 1.0, 3.0, 2.0, 3.0, 1.0 }, false, 3) == std::vector<int>({ 1, 3, 2 }));
+    REQUIRE(bayesnet::selectKBest({ 1.0, 3.0, 2.0, 3.0, 1.0 }, true, 4) == std::vector<int>({ 4, 2, 1, 3 }));
+}
+TEST_CASE("Approximate scores", "[Metrics]")
+{
+    auto raw = RawDatasets("glass", true);
+    bayesnet::Metrics exact(raw.dataset, raw.features, raw.className, raw.classNumStates);
+    bayesnet::Metrics metrics(raw.dataset, raw.features, raw.className, raw.classNumStates);
+    REQUIRE_THROWS_AS(metrics.setApproximation(-1), std::invalid_argument);
+    REQUIRE_THROWS_AS(metrics.setApproximation(100, 1.0), std::invalid_argument);
+    std::vector<int> excluded;
+    auto expected = exact.SelectKBestWeighted(raw.weights, false, 4);
+    auto expectedPairs = exact.SelectKPairs(raw.weights, excluded, false, 5);
+    REQUIRE(exact.getExactScored() == 0);
+    // A subsample as large as the dataset is the exact computation
+    metrics.setApproximation(raw.dataset.size(1));
+    REQUIRE(metrics.SelectKBestWeighted(raw.weights, false, 4) == expected);
+    REQUIRE(metrics.getScoresKBest() == exact.getScoresKBest());
+    REQUIRE(metrics.getExactScored() == 0);
+    // With a small subsample and a high confidence the candidates near the cutoff are scored with all the samples
+    metrics.setApproximation(50, 0.999999);
+    REQUIRE(metrics.SelectKBestWeighted(raw.weights, false, 4) == expected);
+    REQUIRE(metrics.getExactScored() > 0);
+    REQUIRE(metrics.SelectKPairs(raw.weights, excluded, false, 5) == expectedPairs);
+    REQUIRE(metrics.getExactScored() > 0);
+    // Without a cutoff every score is an estimate
+    auto all = metrics.SelectKBestWeighted(raw.weights, false, 0);
+    REQUIRE(metrics.getExactScored() == 0);
+    REQUIRE(all.size() == raw.features.size());
+    auto matrix = metrics.conditionalEdge(raw.weights);
+    auto halfWidths = metrics.getConditionalEdgeHalfWidths();
+    auto expectedMatrix = exact.conditionalEdge(raw.weights);
+    REQUIRE(matrix.size(0) == expectedMatrix.size(0));
+    REQUIRE(matrix.min().item<float>() >= 0);
+    REQUIRE(exact.getConditionalEdgeHalfWidths().equal(torch::zeros_like(expectedMatrix)));
+    // Every estimate is inside its confidence interval around the exact value
+    REQUIRE(halfWidths.max().item<float>() > 0);
+    REQUIRE(((matrix - expectedMatrix).abs() <= halfWidths).all().item<bool>());
+}
+TEST_CASE("Statistics cache", "[Metrics]")
+{
+    auto raw = RawDatasets("glass", true);
+    auto cache = std::make_shared<bayesnet::StatisticsCache>(raw.dataset);
+    bayesnet::Metrics exact(raw.dataset, raw.features, raw.className, raw.classNumStates);
+    bayesnet::Metrics first(raw.dataset, raw.features, raw.className, raw.classNumStates);
+    bayesnet::Metrics second(raw.dataset, raw.features, raw.className, raw.classNumStates);
+    first.setStatisticsCache(cache);
+    second.setStatisticsCache(cache);
+    std::vector<int> excluded = { 2 };
+    REQUIRE(first.SelectKBestWeighted(raw.weights, false, 3) == exact.SelectKBestWeighted(raw.weights, false, 3));
+    REQUIRE(first.SelectKPairs(raw.weights, excluded, false, 4) == exact.SelectKPairs(raw.weights, excluded, false, 4));
+    REQUIRE(first.getScoresKPairs() == exact.getScoresKPairs());
+    REQUIRE(first.conditionalEdge(raw.weights).equal(exact.conditionalEdge(raw.weights)));
+    REQUIRE(cache->getMisses() == 3);
+    REQUIRE(cache->getHits() == 0);
+    // Same weights: taken from the cache
+    excluded.clear();
+    REQUIRE(second.SelectKBestWeighted(raw.weights, true, 5) == exact.SelectKBestWeighted(raw.weights, true, 5));
+    REQUIRE(second.SelectKPairs(raw.weights, excluded, true, 6) == exact.SelectKPairs(raw.weights, excluded, true, 6));
+    REQUIRE(second.conditionalEdge(raw.weights).equal(exact.conditionalEdge(raw.weights)));
+    REQUIRE(cache->getHits() == 3);
+    // Other weights are another version of the statistics
+    auto weights = raw.weights * 2;
+    REQUIRE(second.SelectKBestWeighted(weights, false, 3) == exact.SelectKBestWeighted(weights, false, 3));
+    REQUIRE(cache->getMisses() == 4);
+    REQUIRE(cache->size() == 4);
+    // Equal weights share one version, the samples are recognized by their storage
+    REQUIRE(cache->getWeightsVersion(raw.weights.clone()) == cache->getWeightsVersion(raw.weights));
+    REQUIRE(cache->getWeightsVersion(weights) != cache->getWeightsVersion(raw.weights));
+    // Only the last weights are kept, the statistics of the dropped ones are not stored anymore
+    auto version = cache->getWeightsVersion(raw.weights);
+    for (size_t i = 0; i < bayesnet::StatisticsCache::maxWeightsVersions; ++i) {
+        cache->getWeightsVersion(raw.weights * static_cast<double>(i + 3));
+    }
+    REQUIRE(cache->getNumWeightsVersions() == bayesnet::StatisticsCache::maxWeightsVersions);
+    REQUIRE(cache->size() == 0);
+    REQUIRE(cache->get("I(Xi;C)", version, [&]() { return torch::ones({ 1 }); }).equal(torch::ones({ 1 })));
+    REQUIRE(cache->size() == 0);
+    REQUIRE(cache->getWeightsVersion(raw.weights) != version);
+    REQUIRE(cache->matches(raw.dataset));
+    REQUIRE_FALSE(cache->matches(raw.dataset.clone()));
+    auto iris = RawDatasets("iris", true);
+    bayesnet::Metrics other(iris.dataset, iris.features, iris.className, iris.classNumStates);
+    REQUIRE_THROWS_AS(other.setStatisticsCache(cache), std::invalid_argument);
+}
+TEST_CASE("Histogram kernels", "[Metrics]")
+{
+    using bayesnet::ContingencyTable;
+    auto raw = RawDatasets("diabetes", true);
+    auto data = raw.dataset.to(torch::kInt32).contiguous();
+    auto weights = torch::rand({ data.size(1) }, torch::kFloat64);
+    const int* x = data.data_ptr<int>();
+    const int* y = x + data.size(1);
+    const int* c = x + (data.size(0) - 1) * data.size(1);
+    auto states = data.amax(1) + 1;
+    int sx = states[0].item<int>(), sy = states[1].item<int>(), sc = states[-1].item<int>();
+    auto kernel = ContingencyTable::getKernel();
+    ContingencyTable::setKernel(ContingencyTable::Kernel::SCALAR);
+    auto expected1 = ContingencyTable::count(x, weights.data_ptr<double>(), data.size(1), sx);
+    auto expected3 = ContingencyTable::count(x, y, c, weights.data_ptr<double>(), data.size(1), sx, sy, sc);
+    for (auto candidate : { ContingencyTable::Kernel::AVX2, ContingencyTable::Kernel::AVX512 }) {
+        if (!ContingencyTable::isSupported(candidate)) {
+            REQUIRE_THROWS_AS(ContingencyTable::setKernel(candidate), std::invalid_argument);
+            continue;
+        }
+        ContingencyTable::setKernel(candidate);
+        auto counts1 = ContingencyTable::count(x, weights.data_ptr<double>(), data.size(1), sx);
+        auto counts3 = ContingencyTable::count(x, y, c, weights.data_ptr<double>(), data.size(1), sx, sy, sc);
+        for (int i = 0; i < counts1.size(); ++i) {
+            REQUIRE(counts1[i] == Catch::Approx(expected1[i]).epsilon(1e-12));
+        }
+        for (int i = 0; i < counts3.size(); ++i) {
+            REQUIRE(counts3[i] == Catch::Approx(expected3[i]).epsilon(1e-12).margin(1e-12));
+        }
+    }
+    ContingencyTable::setKernel(kernel);
+}
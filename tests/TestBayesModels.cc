@@ -341,6 +341,25 @@ TEST_CASE("KDB with hyperparameters", "[Models]")
     REQUIRE(score == Catch::Approx(0.827103).epsilon(raw.epsilon));
     REQUIRE(scoret == Catch::Approx(0.761682).epsilon(raw.epsilon));
 }
+TEST_CASE("KDB parents", "[Models]")
+{
+    auto raw = RawDatasets("glass", true);
+    std::vector<std::pair<std::string, std::string>> previous;
+    for (int k = 1; k <= 5; ++k) {
+        auto clf = bayesnet::KDB(k);
+        clf.fit(raw.Xv, raw.yv, raw.features, raw.className, raw.states, raw.smoothing);
+        for (const auto& [name, node] : clf.getModel().getNodes()) {
+            // the class plus at most k features
+            REQUIRE(node->getParents().size() <= static_cast<size_t>(name == raw.className ? 0 : k + 1));
+        }
+        // The k best parents of every feature include the k - 1 best ones
+        auto edges = clf.getModel().getEdges();
+        for (const auto& edge : previous) {
+            REQUIRE(std::find(edges.begin(), edges.end(), edge) != edges.end());
+        }
+        previous = edges;
+    }
+}
 TEST_CASE("Incorrect type of data for Ld models", "[Models]")
 {
     auto raw = RawDatasets("iris", true);
@@ -552,3 +571,34 @@ TEST_CASE("Local discretization hyperparameters", "[Models]")
 //     clf.fit(dataset.Xt, dataset.yt, dataset.features, dataset.className, dataset.states, dataset.smoothing);
 //     std::cout << "Score: " << clf.score(dataset.Xt, dataset.yt) << std::endl;
 // }
+TEST_CASE("Shared statistics cache", "[Models]")
+{
+    auto raw = RawDatasets("glass", true);
+    auto cache = std::make_shared<bayesnet::StatisticsCache>(raw.dataset);
+    auto tan = bayesnet::TAN();
+    auto kdb = bayesnet::KDB(2);
+    tan.fit(raw.dataset, raw.features, raw.className, raw.states, raw.smoothing);
+    kdb.fit(raw.dataset, raw.features, raw.className, raw.states, raw.smoothing);
+    auto tanCached = bayesnet::TAN();
+    auto kdbCached = bayesnet::KDB(2);
+    tanCached.setStatisticsCache(cache);
+    kdbCached.setStatisticsCache(cache);
+    tanCached.fit(raw.dataset, raw.features, raw.className, raw.states, raw.smoothing);
+    auto misses = cache->getMisses();
+    REQUIRE(cache->getHits() == 0);
+    REQUIRE(misses > 0);
+    // The second classifier takes I(Xi;C) and I(Xi;Xj|C) from the cache
+    kdbCached.fit(raw.dataset, raw.features, raw.className, raw.states, raw.smoothing);
+    REQUIRE(cache->getHits() == 2);
+    REQUIRE(cache->getMisses() == misses);
+    REQUIRE(tanCached.show() == tan.show());
+    REQUIRE(kdbCached.show() == kdb.show());
+    REQUIRE(kdbCached.score(raw.Xt, raw.yt) == kdb.score(raw.Xt, raw.yt));
+    // A classifier fitted with other samples does not use the cache
+    auto other = RawDatasets("iris", true);
+    auto tanOther = bayesnet::TAN();
+    tanOther.setStatisticsCache(cache);
+    tanOther.fit(other.dataset, other.features, other.className, other.states, other.smoothing);
+    REQUIRE(cache->getHits() == 2);
+    REQUIRE(cache->getMisses() == misses);
+}
@@ -225,6 +225,227 @@ TEST_CASE("Test Bayesian Network", "[Network]")
             }
         }
     }
+    SECTION("Test compiled inference")
+    {
+        INFO("Test compiled inference");
+        buildModel(net, raw.features, raw.className);
+        net.fit(raw.Xv, raw.yv, raw.weightsv, raw.features, raw.className, raw.states, raw.smoothing);
+        auto y_proba = net.predict_proba(raw.Xv);
+        auto y_proba_t = net.predict_proba(raw.Xt);
+        auto& nodes = net.getNodes();
+        for (int sample = 0; sample < raw.yv.size(); ++sample) {
+            // Evaluate the factors of every node with the evidence of the sample
+            std::map<std::string, int> evidence;
+            for (int feature = 0; feature < raw.features.size(); ++feature) {
+                evidence[raw.features[feature]] = raw.Xv[feature][sample];
+            }
+            std::vector<double> expected(net.getClassNumStates());
+            double sum = 0.0;
+            for (int c = 0; c < expected.size(); ++c) {
+                evidence[raw.className] = c;
+                expected[c] = 1.0;
+                for (auto& [name, node] : nodes) {
+                    expected[c] *= node->getFactorValue(evidence);
+                }
+                sum += expected[c];
+            }
+            for (int c = 0; c < expected.size(); ++c) {
+                REQUIRE(y_proba[sample][c] == Catch::Approx(expected[c] / sum).margin(threshold));
+                REQUIRE(y_proba_t[sample][c].item<double>() == Catch::Approx(expected[c] / sum).margin(threshold));
+            }
+        }
+    }
+    SECTION("Test batch inference")
+    {
+        INFO("Test batch inference");
+        buildModel(net, raw.features, raw.className);
+        net.fit(raw.Xv, raw.yv, raw.weightsv, raw.features, raw.className, raw.states, raw.smoothing);
+        auto y_proba = net.predict_proba(raw.Xv);
+        auto y_pred = net.predict(raw.Xv);
+        auto y_proba_t = net.predict_proba(raw.Xt);
+        auto y_pred_t = net.predict(raw.Xt);
+        REQUIRE(y_proba_t.size(0) == raw.yv.size());
+        REQUIRE(y_proba_t.size(1) == net.getClassNumStates());
+        for (int sample = 0; sample < raw.yv.size(); ++sample) {
+            REQUIRE(y_pred_t[sample].item<int>() == y_pred[sample]);
+            for (int c = 0; c < net.getClassNumStates(); ++c) {
+                REQUIRE(y_proba_t[sample][c].item<double>() == Catch::Approx(y_proba[sample][c]).margin(threshold));
+            }
+        }
+        auto wrong = raw.Xt.clone();
+        wrong[0][5] = static_cast<int>(raw.states.at(raw.features[0]).size());
+        REQUIRE_THROWS_AS(net.predict_proba(wrong), std::out_of_range);
+    }
+    SECTION("Test log space inference")
+    {
+        INFO("Test log space inference");
+        buildModel(net, raw.features, raw.className);
+        net.fit(raw.Xv, raw.yv, raw.weightsv, raw.features, raw.className, raw.states, raw.smoothing);
+        auto y_proba = net.predict_proba(raw.Xv);
+        auto y_proba_t = net.predict_proba(raw.Xt);
+        REQUIRE(!net.getLogSpace());
+        auto cpt = net.getNodes().at(raw.className)->getCPT();
+        net.setLogSpace(true);
+        REQUIRE(net.getLogSpace());
+        // The plan keeps the log of the CPTs, the nodes compute them again from the counts
+        REQUIRE(torch::allclose(net.getNodes().at(raw.className)->getCPT(), cpt));
+        auto y_proba_log = net.predict_proba(raw.Xv);
+        auto y_proba_log_t = net.predict_proba(raw.Xt);
+        REQUIRE(torch::allclose(y_proba_t, y_proba_log_t));
+        for (int sample = 0; sample < raw.yv.size(); ++sample) {
+            for (int c = 0; c < net.getClassNumStates(); ++c) {
+                REQUIRE(y_proba_log[sample][c] == Catch::Approx(y_proba[sample][c]).margin(threshold));
+            }
+        }
+        // The mode survives a copy and a new fit
+        auto net2 = bayesnet::Network(net);
+        REQUIRE(net2.getLogSpace());
+        net.fit(raw.Xv, raw.yv, raw.weightsv, raw.features, raw.className, raw.states, raw.smoothing);
+        REQUIRE(torch::allclose(y_proba_t, net.predict_proba(raw.Xt)));
+    }
+    SECTION("Test samples with probability 0 for every class")
+    {
+        INFO("Test samples with probability 0 for every class");
+        // A = 0 only with C = 0 and B = 0 only with C = 1, so A = 0, B = 0 is impossible without smoothing
+        net.addNode("A");
+        net.addNode("B");
+        net.addNode("C");
+        net.addEdge("C", "A");
+        net.addEdge("C", "B");
+        std::vector<std::vector<int>> X = { { 0, 1 }, { 1, 0 } };
+        std::vector<int> y = { 0, 1 };
+        std::vector<double> weights = { 0.5, 0.5 };
+        std::map<std::string, std::vector<int>> states = { { "A", { 0, 1 } }, { "B", { 0, 1 } }, { "C", { 0, 1 } } };
+        net.fit(X, y, weights, { "A", "B" }, "C", states, bayesnet::Smoothing_t::NONE);
+        std::vector<std::vector<int>> sample = { { 0 }, { 0 } };
+        auto sampleTensor = torch::zeros({ 2, 1 }, torch::kInt32);
+        for (bool logSpace : { false, true }) {
+            net.setLogSpace(logSpace);
+            REQUIRE(net.predict_proba(sample)[0] == std::vector<double>({ 0.0, 0.0 }));
+            REQUIRE(net.predict_proba(sampleTensor).equal(torch::zeros({ 1, 2 }, torch::kFloat64)));
+        }
+    }
+    SECTION("Test single pass counting")
+    {
+        INFO("Test single pass counting");
+        buildModel(net, raw.features, raw.className);
+        net.fit(raw.Xt, raw.yt, raw.weights, raw.features, raw.className, raw.states, bayesnet::Smoothing_t::LAPLACE);
+        // Every CPT is the same as the one computed node by node
+        auto net2 = bayesnet::Network(net);
+        auto samples = net.getSamples();
+        for (auto& [name, node] : net2.getNodes()) {
+            node->computeCPT(samples, net.getFeatures(), 1.0, raw.weights);
+            REQUIRE(torch::allclose(node->getCPT(), net.getNodes().at(name)->getCPT()));
+        }
+        auto wrong = raw.Xt.clone();
+        wrong[1][0] = static_cast<int>(raw.states.at(raw.features[1]).size());
+        REQUIRE_THROWS_AS(net.fit(wrong, raw.yt, raw.weights, raw.features, raw.className, raw.states, raw.smoothing), std::out_of_range);
+    }
+    SECTION("Test change smoothing without refit")
+    {
+        INFO("Test change smoothing without refit");
+        buildModel(net, raw.features, raw.className);
+        REQUIRE_THROWS_AS(net.setSmoothing(bayesnet::Smoothing_t::LAPLACE), std::logic_error);
+        REQUIRE_THROWS_WITH(net.setSmoothing(bayesnet::Smoothing_t::LAPLACE), "You must call fit() before calling setSmoothing()");
+        auto net2 = bayesnet::Network(net);
+        for (auto smoothing : { bayesnet::Smoothing_t::LAPLACE, bayesnet::Smoothing_t::CESTNIK, bayesnet::Smoothing_t::ORIGINAL }) {
+            net.fit(raw.Xt, raw.yt, raw.weights, raw.features, raw.className, raw.states, bayesnet::Smoothing_t::NONE);
+            net.setSmoothing(smoothing);
+            REQUIRE(net.getSmoothing() == smoothing);
+            net2.fit(raw.Xt, raw.yt, raw.weights, raw.features, raw.className, raw.states, smoothing);
+            for (auto& [name, node] : net2.getNodes()) {
+                REQUIRE(torch::allclose(node->getCPT(), net.getNodes().at(name)->getCPT()));
+            }
+            REQUIRE(torch::allclose(net.predict_proba(raw.Xt), net2.predict_proba(raw.Xt)));
+        }
+    }
+    SECTION("Test partial fit")
+    {
+        INFO("Test partial fit");
+        buildModel(net, raw.features, raw.className);
+        auto net2 = bayesnet::Network(net);
+        REQUIRE_THROWS_AS(net.partial_fit(raw.Xt, raw.yt, raw.weights), std::logic_error);
+        auto even = torch::arange(0, raw.Xt.size(1), 2, torch::kLong);
+        auto odd = torch::arange(1, raw.Xt.size(1), 2, torch::kLong);
+        auto ones = torch::ones({ raw.Xt.size(1) }, torch::kDouble);
+        auto all = torch::cat({ even, odd }, 0);
+        // Same counts and CPTs as fitting all the samples at once, ORIGINAL smoothing depends on the number of samples
+        for (auto smoothing : { bayesnet::Smoothing_t::LAPLACE, bayesnet::Smoothing_t::ORIGINAL }) {
+            net.fit(raw.Xt.index_select(1, even), raw.yt.index_select(0, even), ones.index_select(0, even), raw.features, raw.className, raw.states, smoothing);
+            net.partial_fit(raw.Xt.index_select(1, odd), raw.yt.index_select(0, odd), ones.index_select(0, odd));
+            REQUIRE(net.getNumSamples() == raw.Xt.size(1));
+            REQUIRE(net.getSamples().size(1) == even.size(0));
+            net2.fit(raw.Xt.index_select(1, all), raw.yt.index_select(0, all), ones, raw.features, raw.className, raw.states, smoothing);
+            for (auto& [name, node] : net2.getNodes()) {
+                REQUIRE(torch::allclose(node->getCounts(), net.getNodes().at(name)->getCounts()));
+                REQUIRE(torch::allclose(node->getCPT(), net.getNodes().at(name)->getCPT()));
+            }
+            REQUIRE(torch::allclose(net.predict_proba(raw.Xt), net2.predict_proba(raw.Xt)));
+        }
+        // Wrong samples are rejected without changing the counts
+        auto wrong = raw.Xt.clone();
+        wrong[0][3] = -1;
+        REQUIRE_THROWS_AS(net.partial_fit(wrong, raw.yt, ones), std::out_of_range);
+        REQUIRE_THROWS_AS(net.partial_fit(raw.Xt, raw.yt.index_select(0, even), ones), std::invalid_argument);
+        REQUIRE(torch::allclose(net.predict_proba(raw.Xt), net2.predict_proba(raw.Xt)));
+    }
+    SECTION("Test merge and sharded fit")
+    {
+        INFO("Test merge and sharded fit");
+        buildModel(net, raw.features, raw.className);
+        auto net2 = bayesnet::Network(net);
+        auto net3 = bayesnet::Network(net);
+        auto net4 = bayesnet::Network(net);
+        auto ones = torch::ones({ raw.Xt.size(1) }, torch::kDouble);
+        auto samples = torch::cat({ raw.Xt, raw.yt.view({ 1, -1 }) }, 0);
+        net.fit(samples, ones, raw.features, raw.className, raw.states, raw.smoothing);
+        REQUIRE_THROWS_AS(net.merge(net2), std::logic_error);
+        // Two halves merged are the same as the whole dataset
+        auto half = raw.Xt.size(1) / 2;
+        net2.fit(samples.narrow(1, 0, half), ones.narrow(0, 0, half), raw.features, raw.className, raw.states, raw.smoothing);
+        net3.fit(samples.narrow(1, half, raw.Xt.size(1) - half), ones.narrow(0, half, raw.Xt.size(1) - half), raw.features, raw.className, raw.states, raw.smoothing);
+        net2.merge(net3);
+        REQUIRE(net2.getNumSamples() == raw.Xt.size(1));
+        for (auto& [name, node] : net.getNodes()) {
+            REQUIRE(torch::allclose(node->getCPT(), net2.getNodes().at(name)->getCPT()));
+        }
+        REQUIRE(torch::allclose(net.predict_proba(raw.Xt), net2.predict_proba(raw.Xt)));
+        for (int shards : { 1, 3, 7 }) {
+            auto sharded = bayesnet::Network(net4);
+            sharded.fit_sharded(samples, ones, raw.features, raw.className, raw.states, raw.smoothing, shards);
+            REQUIRE(sharded.getNumSamples() == raw.Xt.size(1));
+            REQUIRE(torch::allclose(net.predict_proba(raw.Xt), sharded.predict_proba(raw.Xt)));
+        }
+        REQUIRE_THROWS_AS(net4.fit_sharded(samples, ones, raw.features, raw.className, raw.states, raw.smoothing, 0), std::invalid_argument);
+        // Different structure can not be merged
+        auto other = bayesnet::Network();
+        for (const auto& feature : raw.features) {
+            other.addNode(feature);
+        }
+        other.addNode(raw.className);
+        other.fit(samples, ones, raw.features, raw.className, raw.states, raw.smoothing);
+        REQUIRE_THROWS_AS(net.merge(other), std::invalid_argument);
+    }
+    SECTION("Test node ids in copies")
+    {
+        INFO("Test node ids in copies");
+        net.addNode("A");
+        net.addNode("B");
+        net.addNode("C");
+        net.addEdge("A", "B");
+        net.addEdge("B", "C");
+        auto net2 = bayesnet::Network(net);
+        REQUIRE_THROWS_WITH(net2.addEdge("C", "A"), "Adding this edge forms a cycle in the graph.");
+        REQUIRE_THROWS_WITH(net2.addEdge("B", "C"), "Edge B -> C already exists");
+        net2.addEdge("A", "C");
+        REQUIRE(net2.getNumEdges() == 3);
+        REQUIRE(net.getNumEdges() == 2);
+        net.addNode("D");
+        net.addEdge("D", "A");
+        REQUIRE_THROWS_WITH(net.addEdge("C", "D"), "Adding this edge forms a cycle in the graph.");
+        REQUIRE(net.getEdges() == std::vector<pair<std::string, std::string>>{ {"A", "B"}, { "B", "C" }, { "D", "A" } });
+        REQUIRE(net.getFeatures() == std::vector<std::string>{"A", "B", "C", "D"});
+    }
     SECTION("Test score")
     {
         INFO("Test score");
@@ -256,6 +477,13 @@ TEST_CASE("Test Bayesian Network", "[Network]")
             REQUIRE(node->getParents().size() == node2->getParents().size());
             REQUIRE(node->getCPT().equal(node2->getCPT()));
         }
+        // The copy shares the tables until it is changed
+        auto before = net.predict_proba(raw.Xt);
+        auto ones = torch::ones({ raw.Xt.size(1) }, torch::kDouble);
+        net2.partial_fit(raw.Xt, raw.yt, ones);
+        REQUIRE(net2.getNumSamples() == net.getNumSamples() + raw.Xt.size(1));
+        REQUIRE(net.predict_proba(raw.Xt).equal(before));
+        REQUIRE_FALSE(net2.predict_proba(raw.Xt).equal(before));
     }
     SECTION("Network oddities")
     {
@@ -541,6 +769,24 @@ TEST_CASE("Cicle in Network", "[Network]")
     REQUIRE_THROWS_AS(net.addEdge("C", "A"), std::invalid_argument);
     REQUIRE_THROWS_WITH(net.addEdge("C", "A"), "Adding this edge forms a cycle in the graph.");
 }
+TEST_CASE("Cycles in a long chain", "[Network]")
+{
+    // Every edge goes against the order of insertion of the nodes, so the topological order is rebuilt for each one
+    auto net = bayesnet::Network();
+    const int n = 300;
+    for (int i = 0; i < n; ++i) {
+        net.addNode("X" + std::to_string(i));
+    }
+    for (int i = 0; i < n - 1; ++i) {
+        net.addEdge("X" + std::to_string(i + 1), "X" + std::to_string(i));
+    }
+    REQUIRE_THROWS_WITH(net.addEdge("X0", "X" + std::to_string(n - 1)), "Adding this edge forms a cycle in the graph.");
+    REQUIRE_THROWS_WITH(net.addEdge("X5", "X5"), "Adding this edge forms a cycle in the graph.");
+    net.addEdge("X" + std::to_string(n - 1), "X0");
+    net.addEdge("X150", "X20");
+    REQUIRE_THROWS_WITH(net.addEdge("X20", "X149"), "Adding this edge forms a cycle in the graph.");
+    REQUIRE(net.getNumEdges() == n + 1);
+}
 TEST_CASE("Edges troubles", "[Network]")
 {
     auto net = bayesnet::Network();
@@ -9,6 +9,7 @@
 #include <catch2/generators/catch_generators.hpp>
 #include <catch2/matchers/catch_matchers.hpp>
 #include <string>
+#include <utility>
 #include <vector>
 #include "TestUtils.h"
 #include "bayesnet/network/Network.h"
@@ -202,4 +203,24 @@ TEST_CASE("Test operator =", "[Node]")
     REQUIRE(cpt_copy.equal(cpt));
     // Check that the copy has the same number of states
     REQUIRE(node_copy.getNumStates() == node.getNumStates());
-}
\ No newline at end of file
+}
+TEST_CASE("Test copy on write of counts", "[Node]")
+{
+    auto node = bayesnet::Node("N1");
+    node.setNumStates(2);
+    node.initCounts();
+    node.getCounts()[1] += 3.0;
+    node.getCPT();
+    auto node_copy = bayesnet::Node(node);
+    // Copies share the tables until one of them changes its counts
+    REQUIRE(node_copy.getCPT().data_ptr<double>() == node.getCPT().data_ptr<double>());
+    REQUIRE(std::as_const(node_copy).getCounts().data_ptr<double>() == std::as_const(node).getCounts().data_ptr<double>());
+    auto& counts = node_copy.getCounts();
+    REQUIRE(counts.data_ptr<double>() != std::as_const(node).getCounts().data_ptr<double>());
+    counts[0] += 1.0;
+    REQUIRE(node.getCPT().equal(torch::tensor({ 0.0, 1.0 }, torch::kDouble)));
+    REQUIRE(node_copy.getCPT().equal(torch::tensor({ 0.25, 0.75 }, torch::kDouble)));
+    // A released CPT is normalized again from the counts when it is requested
+    node_copy.releaseCPT();
+    REQUIRE(node_copy.getCPT().equal(torch::tensor({ 0.25, 0.75 }, torch::kDouble)));
+}
@@ -322,4 +322,21 @@ TEST_CASE("L1FS Regression vs Classification", "[FeatureSelection]")
 
         delete l1fs;
     }
-}
\ No newline at end of file
+}
+TEST_CASE("Shared SU of the pairs of features", "[FeatureSelection]")
+{
+    auto raw = RawDatasets("glass", true);
+    auto cache = std::make_shared<bayesnet::StatisticsCache>(raw.dataset);
+    for (const auto& selector : { "CFS", "FCBF", "IWSS" }) {
+        INFO("selector: " << selector);
+        std::unique_ptr<bayesnet::FeatureSelect> expected(build_selector(raw, selector, selector == std::string("CFS") ? 0.0 : 0.1));
+        std::unique_ptr<bayesnet::FeatureSelect> cached(build_selector(raw, selector, selector == std::string("CFS") ? 0.0 : 0.1));
+        cached->setStatisticsCache(cache);
+        expected->fit();
+        cached->fit();
+        REQUIRE(cached->getFeatures() == expected->getFeatures());
+        REQUIRE(cached->getScores() == expected->getScores());
+    }
+    // SU(Xi;C) and the matrix of SU(Xi;Xj) are one entry each for all the selectors
+    REQUIRE(cache->size() == 2);
+}
@@ -69,4 +69,14 @@ TEST_CASE("MST::maximumSpanningTree tests", "[MST]")
         auto result = mst.maximumSpanningTree();
         REQUIRE(result.size() == 2); // Un MST para 3 nodos tiene 2 aristas
     }
-}
\ No newline at end of file
+}
+TEST_CASE("MST::maximumSpanningTree ties", "[MST]")
+{
+    // Edges of equal weight are taken in lexicographic order
+    std::vector<std::string> features = { "A", "B", "C", "D" };
+    auto weights = torch::ones({ 4, 4 });
+    bayesnet::MST mst(features, weights, 2);
+    REQUIRE(mst.maximumSpanningTree() == std::vector<std::pair<int, int>>{{2, 0}, { 0, 1 }, { 0, 3 }});
+    bayesnet::MST single({ "A" }, torch::ones({ 1, 1 }), 0);
+    REQUIRE(single.maximumSpanningTree().empty());
+}
@@ -0,0 +1,57 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include "bayesnet/utils/ThreadPool.h"
+
+TEST_CASE("Every element is visited once", "[ThreadPool]")
+{
+    auto& pool = bayesnet::ThreadPool::getInstance();
+    REQUIRE(pool.getNumThreads() >= 1);
+    std::vector<int> visits(1000, 0);
+    pool.parallel_for(0, visits.size(), 7, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            visits[i]++;
+        }
+        });
+    for (auto visit : visits) {
+        REQUIRE(visit == 1);
+    }
+    // Empty range does not call the body
+    bool called = false;
+    pool.parallel_for(5, 5, [&](int64_t, int64_t) { called = true; });
+    REQUIRE(!called);
+}
+TEST_CASE("Nested parallel for", "[ThreadPool]")
+{
+    auto& pool = bayesnet::ThreadPool::getInstance();
+    std::atomic<int64_t> sum{ 0 };
+    pool.parallel_for(0, 1000, 10, [&](int64_t begin, int64_t end) {
+        pool.parallel_for(begin, end, 2, [&](int64_t from, int64_t to) {
+            for (int64_t i = from; i < to; ++i) {
+                sum += i;
+            }
+            });
+        });
+    REQUIRE(sum == 499500);
+}
+TEST_CASE("Exceptions reach the caller", "[ThreadPool]")
+{
+    auto& pool = bayesnet::ThreadPool::getInstance();
+    auto body = [](int64_t begin, int64_t end) {
+        if (begin <= 50 && 50 < end) {
+            throw std::out_of_range("element 50");
+        }
+        };
+    REQUIRE_THROWS_AS(pool.parallel_for(0, 100, 1, body), std::out_of_range);
+    // The pool is still usable afterwards
+    std::atomic<int> count{ 0 };
+    pool.parallel_for(0, 100, 1, [&](int64_t begin, int64_t end) { count += end - begin; });
+    REQUIRE(count == 100);
+}
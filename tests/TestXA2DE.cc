@@ -0,0 +1,73 @@
+// ***************************************************************
+// SPDX-FileCopyrightText: Copyright 2025 Ricardo Montañana Gómez
+// SPDX-FileType: SOURCE
+// SPDX-License-Identifier: MIT
+// ***************************************************************
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include "TestUtils.h"
+#include "bayesnet/ensembles/A2DE.h"
+#include "bayesnet/ensembles/XA2DE.h"
+
+TEST_CASE("Same model as A2DE", "[XA2DE]")
+{
+    auto voting = GENERATE(false, true);
+    auto raw = RawDatasets("glass", true);
+    auto clf = bayesnet::XA2DE(voting);
+    auto a2de = bayesnet::A2DE(voting);
+    clf.fit(raw.Xv, raw.yv, raw.features, raw.className, raw.states, raw.smoothing);
+    a2de.fit(raw.Xv, raw.yv, raw.features, raw.className, raw.states, raw.smoothing);
+    REQUIRE(clf.predict_proba(raw.Xt).scalar_type() == torch::kFloat32);
+    REQUIRE(torch::allclose(clf.predict_proba(raw.Xt), a2de.predict_proba(raw.Xt), 1e-4, 1e-6));
+    REQUIRE(clf.score(raw.Xv, raw.yv) == Catch::Approx(a2de.score(raw.Xv, raw.yv)).epsilon(raw.epsilon));
+    REQUIRE(clf.score(raw.Xt, raw.yt) == Catch::Approx(a2de.score(raw.Xt, raw.yt)).epsilon(raw.epsilon));
+    REQUIRE(clf.getNumberOfNodes() == 360);
+    REQUIRE(clf.getNumberOfEdges() == 756);
+    REQUIRE(clf.getNumberOfStates() == a2de.getNumberOfStates());
+    REQUIRE(clf.getClassNumStates() == raw.classNumStates);
+}
+TEST_CASE("Smoothing", "[XA2DE]")
+{
+    auto smoothing = GENERATE(bayesnet::Smoothing_t::LAPLACE, bayesnet::Smoothing_t::CESTNIK);
+    auto raw = RawDatasets("iris", true);
+    auto clf = bayesnet::XA2DE();
+    auto a2de = bayesnet::A2DE();
+    clf.fit(raw.Xv, raw.yv, raw.features, raw.className, raw.states, smoothing);
+    a2de.fit(raw.Xv, raw.yv, raw.features, raw.className, raw.states, smoothing);
+    REQUIRE(torch::allclose(clf.predict_proba(raw.Xt), a2de.predict_proba(raw.Xt), 1e-4, 1e-6));
+}
+TEST_CASE("Partial fit", "[XA2DE]")
+{
+    auto raw = RawDatasets("glass", true);
+    auto clf = bayesnet::XA2DE();
+    auto expected = bayesnet::XA2DE();
+    expected.fit(raw.Xt, raw.yt, raw.features, raw.className, raw.states, bayesnet::Smoothing_t::LAPLACE);
+    // Same counts with the samples split in two batches
+    int half = raw.nSamples / 2;
+    auto weights = torch::full({ raw.nSamples }, 1.0 / raw.nSamples, torch::kFloat64);
+    auto first = raw.dataset.narrow(1, 0, half);
+    clf.fit(first, raw.features, raw.className, raw.states, weights.narrow(0, 0, half), bayesnet::Smoothing_t::LAPLACE);
+    auto X = raw.Xt.narrow(1, half, raw.nSamples - half);
+    auto y = raw.yt.narrow(0, half, raw.nSamples - half);
+    clf.partial_fit(X, y, weights.narrow(0, half, raw.nSamples - half));
+    REQUIRE(torch::allclose(clf.predict_proba(raw.Xt), expected.predict_proba(raw.Xt)));
+    auto wrong = X.clone();
+    wrong[0][0] = 100;
+    REQUIRE_THROWS_AS(clf.partial_fit(wrong, y, weights.narrow(0, half, raw.nSamples - half)), std::out_of_range);
+}
+TEST_CASE("Oddities", "[XA2DE]")
+{
+    auto raw = RawDatasets("iris", true);
+    auto clf = bayesnet::XA2DE();
+    REQUIRE_THROWS_AS(clf.predict(raw.Xt), std::logic_error);
+    clf.setHyperparameters({ {"predict_voting", true} });
+    REQUIRE_THROWS_AS(clf.setHyperparameters({ {"parent1", 0} }), std::invalid_argument);
+    clf.fit(raw.Xv, raw.yv, raw.features, raw.className, raw.states, raw.smoothing);
+    auto X = raw.Xt.clone();
+    X[0][0] = 100;
+    REQUIRE_THROWS_AS(clf.predict_proba(X), std::out_of_range);
+    auto fewer = raw.Xt.narrow(0, 0, 3);
+    REQUIRE_THROWS_AS(clf.predict(fewer), std::invalid_argument);
+}
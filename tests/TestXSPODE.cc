@@ -124,3 +124,37 @@ TEST_CASE("Test to_string and fitx", "[XSPODE]")
   REQUIRE(clf.to_string().size() == 1966);
   REQUIRE(clf.graph("Not yet implemented") == std::vector<std::string>({"Not yet implemented"}));
 }
+TEST_CASE("Log space predict", "[XSPODE]")
+{
+  auto raw = RawDatasets("iris", true);
+  for (int i = 0; i < 4; ++i) {
+    auto clf = bayesnet::XSpode(i);
+    auto clf_log = bayesnet::XSpode(i);
+    clf_log.setHyperparameters({ {"log_space", true} });
+    clf.fit(raw.Xt, raw.yt, raw.features, raw.className, raw.states, raw.smoothing);
+    clf_log.fit(raw.Xt, raw.yt, raw.features, raw.className, raw.states, raw.smoothing);
+    auto proba = clf.predict_proba(raw.X_test);
+    auto proba_log = clf_log.predict_proba(raw.X_test);
+    REQUIRE(torch::allclose(proba, proba_log));
+    REQUIRE(clf_log.score(raw.X_test, raw.y_test) == clf.score(raw.X_test, raw.y_test));
+  }
+}
+TEST_CASE("Partial fit", "[XSPODE]")
+{
+  auto raw = RawDatasets("iris", true);
+  auto clf = bayesnet::XSpode(0);
+  auto clf_all = bayesnet::XSpode(0);
+  auto weights = torch::ones({ raw.Xt.size(1) }, torch::kFloat64);
+  REQUIRE_THROWS_AS(clf.partial_fit(raw.Xt, raw.yt, weights), std::logic_error);
+  clf.fitx(raw.Xt, raw.yt, weights, bayesnet::Smoothing_t::LAPLACE);
+  clf.partial_fit(raw.Xt, raw.yt, weights);
+  // Same as fitting the samples twice in one go
+  auto X2 = torch::cat({ raw.Xt, raw.Xt }, 1);
+  auto y2 = torch::cat({ raw.yt, raw.yt }, 0);
+  auto weights2 = torch::ones({ X2.size(1) }, torch::kFloat64);
+  clf_all.fitx(X2, y2, weights2, bayesnet::Smoothing_t::LAPLACE);
+  REQUIRE(torch::allclose(clf.predict_proba(raw.X_test), clf_all.predict_proba(raw.X_test)));
+  auto wrong = raw.Xt.clone();
+  wrong[0][0] = 1000;
+  REQUIRE_THROWS_AS(clf.partial_fit(wrong, raw.yt, weights), std::out_of_range);
+}